@@ -0,0 +1,1713 @@
+// bench.cpp : 一フレームあたりの処理時間を計測します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+// 使い方: autopilot-bench [-n 個数]... [-f フレーム数]
+//
+// 制限区間・閉塞・予定・勾配をそれぞれ N 個ずつ並べた合成路線を走行し、
+// Main::経過 一回あたりの処理時間の中央値・99 パーセンタイル・最大値を
+// ナノ秒単位でタブ区切りで書き出す。同じ走行を部品ごとに再生して
+// 各部品の処理時間も書き出す。さらに勾配を 50 m ごとに 4N 回変える
+// 山岳線と、256 個全てのパネルに出力する運転台、閉塞 200 個分を
+// まとめて受信する路線、一度に 48 個の地上子を受け取る駅 (互換モードなしと
+// メトロ総合) でも計測する。途中でブレーキの効きが変わる車両では
+// 制動力推定が実際の減速度に追従するまでのフレーム数を以前の方法と比べる。
+// 途中で保存した状態から走り直し、出力が一致するかも確かめる。
+// 停車駅の手前では TASC の停止予測の処理時間と予測の外れ方を計測する。
+// -n を省略すると N = 10, 100, 500 で計測する。
+// 計算方法を変えた処理は以前の方法と結果を比較し、一致しなければ
+// 終了コード 1 で終わる。
+
+#include "stdafx.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Main.h"
+#include "信号順守.h"
+#include "停止予測.h"
+#include "共通状態.h"
+#include "制限グラフ.h"
+#include "パターン一括評価.h"
+#include "加速度計.h"
+#include "勾配グラフ.h"
+#include "地上子振り分け.h"
+#include "早着防止.h"
+#include "合成路線.h"
+#include "走行モデル.h"
+#include "減速パターン.h"
+
+namespace
+{
+
+    /// operator new が呼ばれた回数と確保したバイト数の合計
+    std::uint64_t メモリ確保回数 = 0, メモリ確保量 = 0;
+
+}
+
+// 毎フレームの処理がメモリを確保しないことを確かめるため、
+// この実行ファイルでは全ての new と delete を置き換える
+
+void *operator new(std::size_t 大きさ)
+{
+    メモリ確保回数++;
+    メモリ確保量 += 大きさ;
+    if (void *p = std::malloc(大きさ == 0 ? 1 : 大きさ)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+    using namespace autopilot;
+
+    constexpr int フレーム間隔 = 20; // ms
+    constexpr int パネル数 = 256;
+    constexpr int 音声数 = 256;
+
+    /// パネル出力をすべて計測対象に含めるための設定ファイルの内容
+    constexpr const char 設定内容[] =
+        "[panel]\n"
+        "0 = brake\n"
+        "1 = power\n"
+        "2 = tascenabled\n"
+        "3 = tascmonitor\n"
+        "4 = tascbrake\n"
+        "5 = tascdistance\n"
+        "6 = tascdistancesign\n"
+        "7 = tascdistancedm2\n"
+        "8 = tascdistancedm1\n"
+        "9 = tascdistanced0\n"
+        "10 = tascdistanced1\n"
+        "11 = tascdistanced2\n"
+        "12 = tascdistanced3\n"
+        "13 = tascdistanced4\n"
+        "14 = tascdistanced5\n"
+        "15 = atoenabled\n"
+        "16 = powerthrottle\n"
+        "17 = speedlimit\n"
+        "18 = speedpattern\n"
+        "19 = orpspeedlimit\n"
+        "20 = compatmode\n";
+
+    /// 大きな運転台を想定し、256 個全てのパネルに出力する設定ファイルの
+    /// 内容を作る。速度雑音も出力するよう加速度は最小二乗法で推定する
+    std::string 全パネル設定内容()
+    {
+        static const char *const 名前一覧[] = {
+            "brake", "power", "tascenabled", "tascmonitor", "tascbrake",
+            "tascdistance", "tascdistancesign", "tascdistancedm2",
+            "tascdistancedm1", "tascdistanced0", "tascdistanced1",
+            "tascdistanced2", "tascdistanced3", "tascdistanced4",
+            "tascdistanced5", "atoenabled", "powerthrottle", "speedlimit",
+            "speedpattern", "orpspeedlimit", "compatmode",
+            "tascpredictederror", "tascpredictednotchchanges",
+            "accelerationnoise",
+        };
+        std::string 内容 =
+            "[dynamics]\n"
+            "accelerationmethod = leastsquares\n"
+            "accelerationwindow = 5\n"
+            "[panel]\n";
+        for (int i = 0; i < パネル数; i++) {
+            内容 += std::to_string(i) + " = " +
+                名前一覧[i % std::size(名前一覧)] + "\n";
+        }
+        return 内容;
+    }
+
+    /// 一つの計測項目について毎回の処理時間 (ns) を溜めておく
+    class 計測記録
+    {
+    public:
+        template<typename F>
+        void 計測(F &&処理)
+        {
+            auto 開始 = std::chrono::steady_clock::now();
+            処理();
+            auto 終了 = std::chrono::steady_clock::now();
+            _時間.push_back(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(終了 - 開始).count());
+        }
+
+        /// 計測中に記録用のメモリを確保しないように予め確保しておく
+        void 予約(std::size_t 個数) { _時間.reserve(個数); }
+
+        void 出力(const char *名前, int n)
+        {
+            if (_時間.empty()) {
+                return;
+            }
+            std::sort(_時間.begin(), _時間.end());
+            std::size_t 個数 = _時間.size();
+            std::printf("%s\t%d\t%zu\t%lld\t%lld\t%lld\n",
+                名前, n, 個数,
+                static_cast<long long>(_時間[個数 / 2]),
+                static_cast<long long>(
+                    _時間[std::min(個数 - 1, 個数 * 99 / 100)]),
+                static_cast<long long>(_時間.back()));
+        }
+
+    private:
+        std::vector<std::int64_t> _時間;
+    };
+
+    struct 軌跡
+    {
+        std::vector<ATS_VEHICLESTATE> 状態;
+        std::vector<ATS_HANDLES> ハンドル;
+        共通状態::フレーム内キャッシュ統計 キャッシュ効果;
+        std::uint64_t パネル変化数 = 0; // 全フレームの合計
+    };
+
+    /// 最初の経過の前に BVE 本体が行う呼出し
+    void 運転準備(Main &main, const std::wstring &設定ファイル名)
+    {
+        main.設定ファイル読込(設定ファイル名.c_str());
+        main.車両仕様設定(車両模型::仕様);
+        main.リセット(ATS_INIT_SVC);
+        main.逆転器操作(1);
+        main.制動操作(0);
+        main.力行操作(0);
+        main.戸閉();
+        main.信号現示変化(5);
+    }
+
+    /// Main 全体を合成路線で走らせ、その軌跡を返す。
+    /// パネル記録 があれば経過の後にパネル出力だけをもう一度計測する。
+    軌跡 全体計測(
+        const std::vector<ATS_BEACONDATA> &地上子一覧, int フレーム数,
+        const std::wstring &設定ファイル名, 計測記録 &記録,
+        計測記録 *パネル記録 = nullptr)
+    {
+        static int 出力値[パネル数], 音声状態[音声数];
+        軌跡 結果;
+        車両模型 車両;
+        Main main;
+        運転準備(main, 設定ファイル名);
+
+        ATS_HANDLES ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+        結果.状態.push_back(車両.状態());
+        結果.ハンドル.push_back(ハンドル);
+
+        for (const ATS_BEACONDATA &地上子 : 地上子一覧) {
+            main.地上子通過(地上子);
+        }
+        main.キー押し(ATS_KEY_L);
+        main.キー放し(ATS_KEY_L);
+
+        for (int i = 1; i < フレーム数; i++) {
+            車両.走行(ハンドル, フレーム間隔);
+            記録.計測([&] {
+                ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+            });
+            結果.パネル変化数 += main.パネル変化数();
+            if (パネル記録 != nullptr) {
+                パネル記録->計測([&] { main.パネル出力(出力値); });
+            }
+            結果.状態.push_back(車両.状態());
+            結果.ハンドル.push_back(ハンドル);
+        }
+        結果.キャッシュ効果 = main.状態().キャッシュ効果();
+        return 結果;
+    }
+
+    /// ato と同じ方法で制限区間を追加する
+    void 制限区間追加(制限グラフ &グラフ, const ATS_BEACONDATA &地上子)
+    {
+        if (地上子.Type != 1006) {
+            return;
+        }
+        m 始点 = static_cast<m>(地上子.Optional / 1000);
+        mps 速度 = static_cast<kmph>(地上子.Optional % 1000);
+        グラフ.制限区間追加(始点 - 1.0_s * 速度, 始点, 速度);
+    }
+
+    /// 以前の 早着防止 と同じく、毎フレーム全ての予定について力行後の
+    /// 状態と減速パターンを作り直して早着するか調べる
+    class 全予定早着防止
+    {
+    public:
+        void 発進(const 共通状態 &状態)
+        {
+            _予定表.erase(std::remove_if(_予定表.begin(), _予定表.end(),
+                [&](const 走行モデル &予定) {
+                    return 予定.位置() <= 状態.現在位置() + 5.0_m;
+                }), _予定表.end());
+        }
+
+        void 地上子通過(const ATS_BEACONDATA &地上子, m 直前位置)
+        {
+            if (地上子.Type == 1028) {
+                _次の設定時刻 = static_cast<s>(地上子.Optional);
+            }
+            else if (地上子.Type == 1029) {
+                m 位置 = 直前位置 + static_cast<m>(地上子.Optional / 1000);
+                mps 速度 = static_cast<kmph>(地上子.Optional % 1000);
+                _予定表.emplace_back(位置, 速度, _次の設定時刻);
+            }
+        }
+
+        void 経過(const 共通状態 &状態)
+        {
+            _予定表.erase(std::remove_if(_予定表.begin(), _予定表.end(),
+                [&](const 走行モデル &予定) {
+                    return 予定時刻(予定, 状態) + バッファ < 状態.現在時刻();
+                }), _予定表.end());
+
+            if (加速可(状態)) {
+                _出力ノッチ = 状態.最大力行ノッチ();
+            }
+            else if (状態.現在速度() <= static_cast<mps>(5.0_kmph)) {
+                _出力ノッチ = 力行ノッチ{1};
+            }
+            else {
+                _出力ノッチ = 力行ノッチ{0};
+            }
+        }
+
+        自動制御指令 出力ノッチ() const { return _出力ノッチ; }
+
+    private:
+        static constexpr s バッファ = 0.5_s;
+
+        s _次の設定時刻 = {};
+        std::vector<走行モデル> _予定表;
+        自動制御指令 _出力ノッチ;
+
+        static s 予定時刻(const 走行モデル &予定, const 共通状態 &状態)
+        {
+            constexpr s 正午 = static_cast<s>(12 * 60 * 60);
+            constexpr s 一日 = static_cast<s>(24 * 60 * 60);
+            s 時刻 = 予定.時刻();
+            if (時刻 < 正午 && 正午 <= 状態.現在時刻()) {
+                時刻 += 一日;
+            }
+            return 時刻;
+        }
+
+        bool 加速可(const 共通状態 &状態) const
+        {
+            return std::all_of(
+                _予定表.begin(), _予定表.end(),
+                [&](const 走行モデル &予定) {
+                    走行モデル 走行 = 状態.現在走行状態();
+                    短く力行(走行, 状態.最大力行ノッチ(), 5.0_kmphps, 状態);
+                    減速パターン 減速{
+                        予定.位置(), 予定.速度(), 状態.目安減速度()};
+                    走行モデル 減速開始 = 減速.パターン到達状態(走行.速度());
+                    s 減速時間 = -減速開始.時刻();
+                    走行.指定位置まで走行(減速開始.位置());
+                    s 到達時刻 = 走行.時刻() + 減速時間;
+                    s 基準時刻 = 予定時刻(予定, 状態);
+                    if (状態.前回力行ノッチ() > 0) {
+                        基準時刻 -= バッファ;
+                    }
+                    else {
+                        基準時刻 += バッファ;
+                    }
+                    return 到達時刻 >= 基準時刻;
+                });
+        }
+    };
+
+    /// 全体計測で得た軌跡を部品ごとに再生して処理時間を計測する
+    bool 部品計測(
+        const std::vector<ATS_BEACONDATA> &地上子一覧, const 軌跡 &軌跡,
+        int n)
+    {
+        計測記録 共通状態記録, tasc記録, ato記録, 制限グラフ記録,
+            制限グラフ走査記録, 一括評価記録, 信号順守記録, 早着防止記録,
+            全予定早着防止記録, 勾配記録;
+        パターン一括評価 一括評価;
+        std::size_t 一括評価不一致数 = 0, 早着防止不一致数 = 0;
+        共通状態 状態;
+        // 勾配の計算を含めずに制限グラフの走査だけを計測するために使う
+        共通状態 勾配なし状態;
+        tasc tasc;
+        ato ato;
+        制限グラフ グラフ, 走査グラフ;
+        信号順守 信号;
+        早着防止 早着;
+        全予定早着防止 全予定早着;
+
+        tasc.目標停止位置を監視([&](区間 位置のある範囲) {
+            ato.tasc目標停止位置変化(位置のある範囲);
+            信号.tasc目標停止位置変化(位置のある範囲);
+        });
+
+        状態.車両仕様設定(車両模型::仕様);
+        状態.リセット();
+        勾配なし状態.車両仕様設定(車両模型::仕様);
+        勾配なし状態.リセット();
+        状態.逆転器操作(1);
+        状態.戸閉(true);
+        tasc.リセット();
+        tasc.戸閉(状態);
+        ato.リセット();
+        ato.信号現示変化(5);
+        信号.リセット();
+        信号.信号現示変化(5);
+        早着.リセット();
+
+        for (std::size_t i = 0; i < 軌跡.状態.size(); i++) {
+            m 直前位置 = 状態.現在位置();
+            共通状態記録.計測([&] { 状態.経過(軌跡.状態[i]); });
+            勾配なし状態.経過(軌跡.状態[i]);
+
+            if (i == 1) {
+                for (const ATS_BEACONDATA &地上子 : 地上子一覧) {
+                    状態.地上子通過(地上子, 直前位置);
+                    tasc.地上子通過(地上子, 直前位置, 状態);
+                    ato.地上子通過(地上子, 直前位置, 状態);
+                    信号.地上子通過(地上子, 直前位置, 状態);
+                    早着.地上子通過(地上子, 直前位置);
+                    全予定早着.地上子通過(地上子, 直前位置);
+                    制限区間追加(グラフ, 地上子);
+                    制限区間追加(走査グラフ, 地上子);
+                }
+            }
+
+            if (i > 0) {
+                tasc記録.計測([&] { tasc.経過(状態); });
+                ato記録.計測([&] { ato.経過(状態); });
+                制限グラフ記録.計測([&] {
+                    グラフ.通過(状態.現在位置() - 状態.列車長());
+                    volatile auto ノッチ = グラフ.出力ノッチ(状態);
+                    static_cast<void>(ノッチ);
+                });
+                自動制御指令 個別ノッチ = グラフ.出力ノッチ(状態);
+                パターン一括評価::結果 一括結果;
+                一括評価記録.計測([&] {
+                    一括評価.消去();
+                    グラフ.評価対象追加(一括評価, 状態, 1006);
+                    一括結果 = 一括評価.評価(減速パターン::共通入力{状態});
+                });
+                if (!(一括結果.ノッチ == 個別ノッチ)) {
+                    一括評価不一致数++;
+                }
+                制限グラフ走査記録.計測([&] {
+                    走査グラフ.通過(
+                        勾配なし状態.現在位置() - 勾配なし状態.列車長());
+                    volatile auto ノッチ = 走査グラフ.出力ノッチ(勾配なし状態);
+                    volatile auto 速度 =
+                        走査グラフ.現在常用パターン速度(勾配なし状態);
+                    static_cast<void>(ノッチ);
+                    static_cast<void>(速度);
+                });
+                信号順守記録.計測([&] {
+                    信号.経過(状態);
+                    volatile auto ノッチ = 信号.出力ノッチ(状態);
+                    static_cast<void>(ノッチ);
+                });
+                早着防止記録.計測([&] { 早着.経過(状態); });
+                全予定早着防止記録.計測([&] { 全予定早着.経過(状態); });
+                if (!(早着.出力ノッチ() == 全予定早着.出力ノッチ())) {
+                    早着防止不一致数++;
+                }
+                勾配記録.計測([&] {
+                    volatile auto 加速度 =
+                        状態.進路勾配加速度(状態.現在位置() + 1000.0_m);
+                    static_cast<void>(加速度);
+                });
+            }
+            else {
+                tasc.経過(状態);
+                ato.経過(状態);
+                ato.発進(状態, ato::発進方式::手動);
+                早着.発進(状態);
+                全予定早着.発進(状態);
+            }
+
+            状態.出力(軌跡.ハンドル[i]);
+            勾配なし状態.出力(軌跡.ハンドル[i]);
+        }
+
+        共通状態記録.出力("共通状態::経過", n);
+        tasc記録.出力("tasc::経過", n);
+        ato記録.出力("ato::経過", n);
+        制限グラフ記録.出力("制限グラフ::出力ノッチ", n);
+        制限グラフ走査記録.出力("制限グラフ::走査 (勾配なし)", n);
+        一括評価記録.出力("パターン一括評価::評価", n);
+        信号順守記録.出力("信号順守::出力ノッチ", n);
+        早着防止記録.出力("早着防止::経過", n);
+        全予定早着防止記録.出力("早着防止::経過 (全予定を評価)", n);
+        勾配記録.出力("共通状態::進路勾配加速度", n);
+
+        if (一括評価不一致数 > 0) {
+            std::cerr << "N = " << n << ": パターン一括評価 differs from "
+                "制限グラフ::出力ノッチ in " << 一括評価不一致数 << " frames\n";
+            return false;
+        }
+        if (早着防止不一致数 > 0) {
+            std::cerr << "N = " << n << ": 早着防止 differs from evaluating "
+                "every timetable entry in " << 早着防止不一致数 << " frames\n";
+            return false;
+        }
+        return true;
+    }
+
+    /// 以前の 走行モデル::指定位置まで走行 (等加加速度) の実装。
+    /// 収束を確かめずに必ず 10 回反復する。
+    mps2 十回反復で指定位置まで走行(
+        走行モデル &モデル, m 位置, mps2 初加速度, mps3 加加速度)
+    {
+        走行モデル tmp = モデル;
+        mps2 加速度 = 初加速度;
+        for (std::size_t i = 0; i < 10; i++) {
+            tmp.指定位置まで走行(位置, 加速度);
+            auto 時刻 = tmp.時刻();
+            tmp = モデル;
+            加速度 = tmp.指定時刻まで走行(時刻, 初加速度, 加加速度);
+        }
+
+        モデル = tmp;
+        モデル.位置変更(位置);
+        return 加速度;
+    }
+
+    /// 減速パターン::期待速度と期待減速度 の終盤と同じ計算を、
+    /// 目標位置の異なる N 個のパターンについて軌跡の各位置で行う
+    bool 等加加速度計測(const 軌跡 &軌跡, int n)
+    {
+        constexpr mps 目標速度一覧[] = {
+            0.0_kmph, 25.0_kmph, 45.0_kmph, 75.0_kmph};
+        constexpr mps3 終盤加加速度 = 0.5_kmphps2;
+        constexpr m 終盤区間長 = 200.0_m;
+        計測記録 新記録, 旧記録;
+        std::size_t 不一致数 = 0;
+
+        for (const ATS_VEHICLESTATE &車両状態 : 軌跡.状態) {
+            m 現在位置 = static_cast<m>(車両状態.Location);
+            mps2 新合計{}, 旧合計{};
+
+            新記録.計測([&] {
+                for (int i = 0; i < n; i++) {
+                    m 目標位置 = static_cast<m>((i + 1) * 1000.0);
+                    mps 目標速度 =
+                        目標速度一覧[i % std::size(目標速度一覧)];
+                    走行モデル 走行{目標位置, 目標速度};
+                    新合計 += 走行.指定位置まで走行(
+                        std::max(現在位置, 目標位置 - 終盤区間長),
+                        -減速パターン::標準最終減速度, 終盤加加速度);
+                }
+            });
+            旧記録.計測([&] {
+                for (int i = 0; i < n; i++) {
+                    m 目標位置 = static_cast<m>((i + 1) * 1000.0);
+                    mps 目標速度 =
+                        目標速度一覧[i % std::size(目標速度一覧)];
+                    走行モデル 走行{目標位置, 目標速度};
+                    旧合計 += 十回反復で指定位置まで走行(走行,
+                        std::max(現在位置, 目標位置 - 終盤区間長),
+                        -減速パターン::標準最終減速度, 終盤加加速度);
+                }
+            });
+
+            // 収束したら打ち切るだけなので結果は完全に一致するはず
+            if (!(新合計 == 旧合計) &&
+                !(isnan(新合計) && isnan(旧合計)))
+            {
+                不一致数++;
+            }
+        }
+
+        新記録.出力("走行モデル::指定位置まで走行 (等加加速度)", n);
+        旧記録.出力("走行モデル::指定位置まで走行 (10 回反復)", n);
+        if (不一致数 > 0) {
+            std::cerr << "N = " << n << ": 指定位置まで走行 differs from "
+                "the 10-iteration result in " << 不一致数 << " frames\n";
+            return false;
+        }
+        return true;
+    }
+
+    /// 期待速度と期待減速度一括計算 を一つずつの計算と比べる。
+    /// 目標位置を軌跡の各位置のすぐ先にも置いて、終盤や目標位置を
+    /// 過ぎた場合も含める。
+    bool 期待速度一括計測(const 軌跡 &軌跡, int n)
+    {
+        constexpr mps 目標速度一覧[] = {
+            0.0_kmph, 25.0_kmph, 45.0_kmph, 75.0_kmph, 110.0_kmph};
+        constexpr mps2 初期減速度一覧[] = {
+            2.5_kmphps, 3.0_kmphps, 0.5_kmphps, 2.0_kmphps};
+        計測記録 一括記録, 個別記録;
+        std::size_t 不一致数 = 0;
+        std::vector<m> 目標位置(n);
+        std::vector<mps> 目標速度(n), 一括速度(n), 個別速度(n);
+        std::vector<mps2> 初期減速度(n), 最終減速度(n),
+            一括減速度(n), 個別減速度(n);
+
+        for (const ATS_VEHICLESTATE &車両状態 : 軌跡.状態) {
+            m 現在位置 = static_cast<m>(車両状態.Location);
+            for (int i = 0; i < n; i++) {
+                目標位置[i] = i % 3 == 0 ?
+                    現在位置 + static_cast<m>(i % 200 - 20) :
+                    static_cast<m>((i + 1) * 1000.0);
+                目標速度[i] = 目標速度一覧[i % std::size(目標速度一覧)];
+                初期減速度[i] =
+                    初期減速度一覧[i % std::size(初期減速度一覧)];
+                最終減速度[i] = 目標速度[i] == 0.0_mps ?
+                    減速パターン::停止最終減速度 :
+                    減速パターン::標準最終減速度;
+            }
+
+            一括記録.計測([&] {
+                減速パターン::期待速度と期待減速度一括計算(n,
+                    目標位置.data(), 目標速度.data(),
+                    初期減速度.data(), 最終減速度.data(),
+                    現在位置, 一括速度.data(), 一括減速度.data());
+            });
+            個別記録.計測([&] {
+                for (int i = 0; i < n; i++) {
+                    減速パターン パターン{目標位置[i], 目標速度[i],
+                        初期減速度[i], 最終減速度[i]};
+                    std::tie(個別速度[i], 個別減速度[i]) =
+                        パターン.期待速度と期待減速度(現在位置);
+                }
+            });
+
+            // ビット単位で一致するはず
+            if (std::memcmp(一括速度.data(), 個別速度.data(),
+                    n * sizeof(mps)) != 0 ||
+                std::memcmp(一括減速度.data(), 個別減速度.data(),
+                    n * sizeof(mps2)) != 0)
+            {
+                不一致数++;
+            }
+        }
+
+        一括記録.出力("減速パターン::期待速度と期待減速度一括計算", n);
+        個別記録.出力("減速パターン::期待速度と期待減速度", n);
+        if (不一致数 > 0) {
+            std::cerr << "N = " << n << ": 期待速度と期待減速度一括計算 "
+                "differs from the scalar result in " << 不一致数 <<
+                " frames\n";
+            return false;
+        }
+        return true;
+    }
+
+    /// 山岳線の勾配の設定
+    路線設定 山岳線(int n)
+    {
+        路線設定 設定;
+        設定.制限区間数 = 設定.閉塞数 = 設定.予定数 = n;
+        設定.勾配数 = 4 * n;
+        設定.勾配間隔 = 50;
+        return 設定;
+    }
+
+    /// 勾配グラフ を使わずに全ての勾配区間との重なりから求めた
+    /// 勾配加速度 (検証用)
+    mps2 勾配加速度の参照値(
+        const std::vector<std::pair<m, mps2>> &勾配一覧, 区間 範囲)
+    {
+        mps2 加速度 = 0.0_mps2;
+        for (std::size_t i = 0; i < 勾配一覧.size(); i++) {
+            m 終点 = i + 1 < 勾配一覧.size() ?
+                勾配一覧[i + 1].first : m::無限大();
+            m 長さ = 重なり({勾配一覧[i].first, 終点}, 範囲).長さ();
+            if (長さ > 0.0_m) {
+                加速度 += 勾配一覧[i].second * (長さ / 範囲.長さ());
+            }
+        }
+        return 加速度;
+    }
+
+    /// 山岳線で 勾配グラフ::勾配加速度 を計測する。
+    /// 制限区間ごとに調べるのと同じように、現在位置から N 箇所の
+    /// 前方の地点までの勾配加速度を毎フレーム求める。
+    bool 山岳線勾配計測(const 軌跡 &軌跡, int n)
+    {
+        勾配グラフ グラフ;
+        std::vector<std::pair<m, mps2>> 勾配一覧;
+        for (const ATS_BEACONDATA &地上子 : 路線地上子(山岳線(n))) {
+            if (地上子.Type != 1008) {
+                continue;
+            }
+            int 値 = std::abs(地上子.Optional);
+            m 始点 = static_cast<m>(値 / 1000);
+            double 勾配 = (値 % 1000) * 0.001;
+            if (地上子.Optional < 0) {
+                勾配 = -勾配;
+            }
+            グラフ.勾配区間追加(始点, 勾配);
+            勾配一覧.emplace_back(始点, -0.75 * 9.80665_mps2 * 勾配);
+        }
+
+        計測記録 記録;
+        std::size_t 不一致数 = 0;
+        for (std::size_t f = 0; f < 軌跡.状態.size(); f++) {
+            m 現在位置 = static_cast<m>(軌跡.状態[f].Location);
+            グラフ.通過(現在位置 - 20.0_m);
+
+            mps2 合計{};
+            記録.計測([&] {
+                for (int i = 0; i < n; i++) {
+                    合計 += グラフ.勾配加速度(
+                        {現在位置, 現在位置 + 200.0_m * (i + 1.0)});
+                }
+            });
+            static_cast<void>(合計);
+
+            if (f % 50 != 0) {
+                continue;
+            }
+            for (int i = 0; i < n; i++) {
+                区間 範囲{現在位置, 現在位置 + 200.0_m * (i + 1.0)};
+                mps2 差 = グラフ.勾配加速度(範囲) -
+                    勾配加速度の参照値(勾配一覧, 範囲);
+                if (!(std::abs(差.value) <= 1e-9)) {
+                    不一致数++;
+                }
+            }
+        }
+
+        記録.出力("勾配グラフ::勾配加速度 (山岳線)", n);
+        if (不一致数 > 0) {
+            std::cerr << "N = " << n << ": 勾配グラフ::勾配加速度 differs "
+                "from the reference in " << 不一致数 << " queries\n";
+            return false;
+        }
+        return true;
+    }
+
+    /// 走行しながら前方の制限区間・閉塞・勾配・予定・停止位置の地上子を
+    /// 次々に受信し、駅に停車しては自動発進する長い路線を走る。最初の
+    /// 3 分の 1 より後のフレームで地上子通過・信号現示変化・戸閉・戸開・
+    /// 経過がメモリを確保しないことを確かめる。
+    bool 定常走行メモリ確保計測(int フレーム数, const std::wstring &設定ファイル名)
+    {
+        constexpr int 地上子間隔 = 200; // m
+        constexpr int 制限速度一覧[] = {110, 80, 0, 95, 60};
+        constexpr int 信号一覧[] = {5, 4, 5, 3, 2};
+        constexpr int 勾配一覧[] = {10, -5, 0, 25, -15, 3}; // ‰
+        constexpr int 停車時間 = 10 * 1000; // ms
+
+        static int 出力値[パネル数], 音声状態[音声数];
+        車両模型 車両;
+        Main main;
+        運転準備(main, 設定ファイル名);
+        main.地上子通過({1003, 0, 0, 30}); // 戸閉から 3 秒後に自動発進
+        ATS_HANDLES ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+        main.キー押し(ATS_KEY_L);
+        main.キー放し(ATS_KEY_L);
+
+        int 受信済区切り = -1;
+        bool 停車予定 = false;
+        int 戸開時刻 = -1, 停車回数 = 0;
+        // 初めての停車・発車で確保するのは構わないので、一度停車して
+        // 戸閉してから数える
+        bool 計測中 = false, 戸閉済 = false;
+        int 計測フレーム数 = 0;
+        std::uint64_t 確保回数 = 0;
+        for (int i = 1; i < フレーム数; i++) {
+            std::uint64_t 開始時確保回数 = メモリ確保回数;
+            計測中 = 戸閉済; // 戸閉したフレームの次から
+
+            int 区切り = static_cast<int>(車両.状態().Location) / 地上子間隔;
+            for (; 受信済区切り < 区切り; 受信済区切り++) {
+                int k = 受信済区切り + 1;
+                int 速度 = 制限速度一覧[k % std::size(制限速度一覧)];
+                int 勾配 = 勾配一覧[k % std::size(勾配一覧)];
+                int 勾配値 = 300 * 1000 + std::abs(勾配);
+                main.地上子通過({1006, 0, 0, 400 * 1000 + 速度});
+                main.地上子通過({1012, 信号一覧[k % std::size(信号一覧)],
+                    400.0f, 0});
+                main.地上子通過({1008, 0, 0, 勾配 < 0 ? -勾配値 : 勾配値});
+                if (k % 5 == 0) {
+                    int 時刻 = 車両.状態().Time / 1000 + 60;
+                    main.地上子通過({1028, 0, 0, 時刻});
+                    main.地上子通過({1029, 0, 0, 1000 * 1000 + 50});
+                }
+                if (k % 7 == 0) {
+                    main.信号現示変化(信号一覧[k / 7 % std::size(信号一覧)]);
+                }
+                if (k % 10 == 5) {
+                    main.地上子通過({1030, 0, 0, 400 * 1000});
+                    停車予定 = true;
+                }
+            }
+
+            int 時刻 = 車両.状態().Time;
+            if (停車予定 && 戸開時刻 < 0 && 車両.状態().Speed == 0) {
+                main.戸開();
+                戸開時刻 = 時刻;
+                停車回数++;
+            }
+            else if (戸開時刻 >= 0 && 時刻 - 戸開時刻 >= 停車時間) {
+                main.戸閉();
+                停車予定 = false;
+                戸開時刻 = -1;
+                戸閉済 = true;
+            }
+
+            車両.走行(ハンドル, フレーム間隔);
+            ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+
+            if (計測中) {
+                確保回数 += メモリ確保回数 - 開始時確保回数;
+                計測フレーム数++;
+            }
+        }
+
+        if (!計測中) {
+            std::cerr << "steady state: not checked, " << フレーム数
+                << " frames end before the first stop and departure "
+                "(run with more frames)\n";
+            return true;
+        }
+        std::cerr << "steady state: " << 確保回数 << " allocations in "
+            << 計測フレーム数 << " frames after the first stop over "
+            << 車両.状態().Location << " m with " << 停車回数
+            << " stops\n";
+#ifdef NDEBUG
+        return 確保回数 == 0;
+#else
+        // デバッグビルドでは信号グラフを毎回作り直して照合するので確保する
+        return true;
+#endif
+    }
+
+    /// ATS-P の路線のように閉塞 200 個分の信号と停止信号前照査を始点で
+    /// まとめて受信する路線
+    路線設定 閉塞路線()
+    {
+        路線設定 設定;
+        設定.閉塞数 = 200;
+        設定.停止信号前照査数 = 3;
+        設定.間隔 = 150;
+        return 設定;
+    }
+
+    /// 閉塞路線の地上子を受信してから最後の閉塞まで走り、リセットする
+    /// ことを繰り返して 信号順守 の処理時間とメモリ確保回数を計測する。
+    /// 二回目以降にメモリを確保したら失敗とする。
+    bool 閉塞計測(int 回数)
+    {
+        constexpr double フレーム毎距離 = 2.0; // m (信号順守は速度によらない)
+        std::vector<ATS_BEACONDATA> 地上子一覧 = 路線地上子(閉塞路線());
+        double 路線長 = 閉塞路線().閉塞数 * 閉塞路線().間隔 + 100.0;
+
+        計測記録 リセット記録, 受信記録, 経過記録;
+        リセット記録.予約(回数);
+        受信記録.予約(回数);
+        経過記録.予約(static_cast<std::size_t>(
+            回数 * (路線長 / フレーム毎距離 + 1)));
+        共通状態 状態;
+        信号順守 信号;
+        ATS_VEHICLESTATE 車両状態 = {};
+        車両状態.Time = 車両模型::開始時刻;
+        車両状態.Speed = static_cast<float>(
+            フレーム毎距離 * 1000 / フレーム間隔 * 3.6);
+        状態.車両仕様設定(車両模型::仕様);
+        状態.リセット();
+
+        std::uint64_t 初回確保回数 = 0, 初回確保量 = 0, 以降確保回数 = 0;
+        for (int k = 0; k < 回数; k++) {
+            std::uint64_t 開始時確保回数 = メモリ確保回数;
+            std::uint64_t 開始時確保量 = メモリ確保量;
+
+            車両状態.Location = 0;
+            車両状態.Time += フレーム間隔;
+            状態.経過(車両状態);
+            リセット記録.計測([&] { 信号.リセット(); });
+            信号.信号現示変化(5);
+            受信記録.計測([&] {
+                for (const ATS_BEACONDATA &地上子 : 地上子一覧) {
+                    信号.地上子通過(地上子, 0.0_m, 状態);
+                }
+            });
+
+            while (車両状態.Location < 路線長) {
+                車両状態.Location += フレーム毎距離;
+                車両状態.Time += フレーム間隔;
+                状態.経過(車両状態);
+                経過記録.計測([&] {
+                    信号.経過(状態);
+                    volatile auto ノッチ = 信号.出力ノッチ(状態);
+                    static_cast<void>(ノッチ);
+                });
+            }
+
+            if (k == 0) {
+                初回確保回数 = メモリ確保回数 - 開始時確保回数;
+                初回確保量 = メモリ確保量 - 開始時確保量;
+            }
+            else {
+                以降確保回数 += メモリ確保回数 - 開始時確保回数;
+            }
+        }
+
+        int n = 閉塞路線().閉塞数;
+        リセット記録.出力("信号順守::リセット (閉塞)", n);
+        受信記録.出力("信号順守::地上子通過 (閉塞, 全て)", n);
+        経過記録.出力("信号順守::経過 (閉塞)", n);
+        std::fflush(stdout);
+        std::cerr << n << " blocks: first run allocated " << 初回確保回数
+            << " times (" << 初回確保量 << " bytes), next " << 回数 - 1
+            << " runs " << 以降確保回数 << " times\n";
+#ifdef NDEBUG
+        return 以降確保回数 == 0;
+#else
+        // デバッグビルドでは信号グラフを毎回作り直して照合するので確保する
+        return true;
+#endif
+    }
+
+    /// 駅で一度に多くの地上子を受け取る場面を想定し、他のプラグイン向けの
+    /// 地上子を多く含む 48 個の地上子を毎フレーム処理する時間を、
+    /// 全ての部品に渡す方法と地上子振り分けを使う方法とで比べる。
+    /// 何度受け取っても状態が変わらない地上子だけを使う。
+    void 地上子振り分け計測(
+        int フレーム数, const char *名前, 互換モード型 モード,
+        std::vector<ATS_BEACONDATA> 地上子一覧)
+    {
+        // ATS-P・ATS-Sx などの地上子
+        constexpr int 他の種類一覧[] = {0, 1, 2, 4, 5, 7, 25, 44, 100, 1000};
+        for (int i = 0; 地上子一覧.size() < 48; i++) {
+            int 種類 = 他の種類一覧[i % std::size(他の種類一覧)];
+            地上子一覧.push_back({種類, i % 6, 100.0f * i, i});
+        }
+
+        共通状態 直接状態, 振り分け状態;
+        tasc 直接tasc, 振り分けtasc;
+        ato 直接ato, 振り分けato;
+        // Main と同じく互換モードごとに表を作り、地上子ごとに選ぶ
+        std::array<地上子振り分け, 4> 振り分け;
+        for (std::size_t i = 0; i < 振り分け.size(); i++) {
+            互換モード型 表のモード = static_cast<互換モード型>(i);
+            振り分け状態.地上子処理登録(振り分け[i]);
+            振り分けtasc.地上子処理登録(振り分け[i], 表のモード);
+            振り分けato.地上子処理登録(振り分け[i], 表のモード);
+        }
+        ATS_BEACONDATA 互換モード設定 = {1001, 0, 0, static_cast<int>(モード)};
+        for (共通状態 *状態 : {&直接状態, &振り分け状態}) {
+            状態->車両仕様設定(車両模型::仕様);
+            状態->リセット();
+            状態->地上子通過(互換モード設定, 0.0_m);
+            状態->戸閉(true);
+            状態->経過(車両模型{}.状態());
+        }
+        for (tasc *t : {&直接tasc, &振り分けtasc}) {
+            t->リセット();
+        }
+        for (ato *a : {&直接ato, &振り分けato}) {
+            a->リセット();
+            a->信号現示変化(5);
+        }
+
+        計測記録 直接記録, 振り分け記録;
+        for (int i = 0; i < フレーム数; i++) {
+            直接記録.計測([&] {
+                for (const ATS_BEACONDATA &地上子 : 地上子一覧) {
+                    直接状態.地上子通過(地上子, 0.0_m);
+                    直接tasc.地上子通過(地上子, 0.0_m, 直接状態);
+                    直接ato.地上子通過(地上子, 0.0_m, 直接状態);
+                }
+            });
+            振り分け記録.計測([&] {
+                for (const ATS_BEACONDATA &地上子 : 地上子一覧) {
+                    std::size_t 番号 =
+                        static_cast<std::size_t>(振り分け状態.互換モード());
+                    振り分け[番号 < 振り分け.size() ? 番号 : 0].実行(
+                        地上子, 0.0_m, 振り分け状態);
+                }
+            });
+        }
+        int n = static_cast<int>(地上子一覧.size());
+        std::string 直接名前 = std::string{"地上子通過 (全ての部品へ"} + 名前;
+        std::string 振り分け名前 =
+            std::string{"地上子通過 (地上子振り分け"} + 名前;
+        直接記録.出力(直接名前.c_str(), n);
+        振り分け記録.出力(振り分け名前.c_str(), n);
+    }
+
+    void 地上子振り分け計測(int フレーム数)
+    {
+        地上子振り分け計測(フレーム数, ")", 互換モード型::無効, {
+            {1002, 0, 0, 30}, {1003, 0, 0, 30}, {255, 0, 0, 500},
+            {1031, 0, 0, 35}, {1011, 0, 0, 5160}, {1012, 4, 300, 0},
+            {1016, 0, 300, 250 * 1000 + 25}, {1012, 3, 600, 0},
+        });
+        // メトロ総合プラグイン互換の駅。他の互換モードの地上子も混ぜる
+        地上子振り分け計測(
+            フレーム数, ", メトロ総合)", 互換モード型::メトロ総合, {
+            {1002, 0, 0, 30}, {31, 4, 300, 0}, {12, 0, 0, 40},
+            {17, 0, 0, 0}, {32, 0, 0, 0}, {1012, 3, 600, 0},
+            {1031, 0, 0, 35}, {30, 0, 0, 500 * 1000}, {3, 2, 200, 0},
+            {6, 0, 0, 45}, {16, 0, 0, 0}, {1006, 0, 0, 80},
+        });
+    }
+
+    /// 以前の 加速度計 と同じく、毎フレーム記録を一つずつずらして
+    /// 窓内の各記録との速度差から求めた加速度を平均する
+    class ずらし加速度計
+    {
+    public:
+        explicit ずらし加速度計(std::size_t 窓長) : _記録(窓長) {}
+
+        void 経過(加速度計::観測 今回)
+        {
+            mps2 旧加速度 = _加速度;
+            s 旧時刻 = _記録.back()._時刻;
+            mps2 加速度和 = 0.0_mps2;
+            std::size_t 記録数 = _記録.size();
+            for (std::size_t i = 0; i < 記録数; i++) {
+                s 時刻差 = 今回._時刻 - _記録[i]._時刻;
+                mps 速度差 = 今回._速度 - _記録[i]._速度;
+                if (時刻差 > 0.0_s) {
+                    加速度和 += 速度差 / 時刻差;
+                }
+                _記録[i] = i + 1 < 記録数 ? _記録[i + 1] : 今回;
+            }
+            _加速度 = 加速度和 / static_cast<double>(記録数);
+            _加加速度 =
+                (_加速度 - 旧加速度) / std::max(今回._時刻 - 旧時刻, 0.0_s);
+        }
+
+        mps2 加速度() const { return _加速度; }
+        mps3 加加速度() const { return _加加速度; }
+
+    private:
+        std::vector<加速度計::観測> _記録;
+        mps2 _加速度 = {};
+        mps3 _加加速度 = {};
+    };
+
+    /// 窓内の記録に直接最小二乗法で直線を当てはめた傾き
+    mps2 直接最小二乗(
+        const std::vector<加速度計::観測> &観測一覧, std::size_t 終端,
+        std::size_t 窓長)
+    {
+        std::size_t 始端 = 終端 > 窓長 ? 終端 - 窓長 : 0;
+        double n = static_cast<double>(終端 - 始端);
+        double x平均 = 0, y平均 = 0;
+        for (std::size_t i = 始端; i < 終端; i++) {
+            x平均 += 観測一覧[i]._時刻.value / n;
+            y平均 += 観測一覧[i]._速度.value / n;
+        }
+        double xx = 0, xy = 0;
+        for (std::size_t i = 始端; i < 終端; i++) {
+            double x = 観測一覧[i]._時刻.value - x平均;
+            xx += x * x;
+            xy += x * (観測一覧[i]._速度.value - y平均);
+        }
+        return static_cast<mps2>(xx > 0 ? xy / xx : 0.0);
+    }
+
+    /// 雑音の乗った速度の記録を加速度計に与え、以前の方法と比べる。
+    /// 既定の 差分平均 は以前と完全に一致し、最小二乗 は直接計算した
+    /// 傾きとほぼ一致するはず。窓を広げた時の処理時間も計測する。
+    bool 加速度計計測(int フレーム数)
+    {
+        constexpr int 一括数 = 1000;
+        std::vector<加速度計::観測> 観測一覧;
+        std::uint32_t 乱数 = 12345;
+        s 時刻 = 車両模型::開始時刻 / 1000.0 * 1.0_s;
+        for (int i = 0; i < フレーム数 * 一括数 / 100; i++) {
+            乱数 = 乱数 * 1664525u + 1013904223u;
+            double 雑音 = (乱数 >> 8) / 16777216.0 - 0.5;
+            double 秒 = i * 0.02;
+            mps 速度 = static_cast<mps>(
+                20.0 + 5.0 * std::sin(秒 / 30.0) + 0.05 * 雑音);
+            if (i == フレーム数 * 一括数 / 200) {
+                時刻 -= 60.0_s; // 駅に戻った時のように時刻が戻る
+            }
+            観測一覧.push_back({速度, 時刻});
+            時刻 += static_cast<s>(0.02);
+        }
+
+        std::size_t 不一致数 = 0;
+        {
+            加速度計 新;
+            新.リセット();
+            ずらし加速度計 旧{加速度計::既定窓長};
+            for (const 加速度計::観測 &観測 : 観測一覧) {
+                新.経過(観測);
+                旧.経過(観測);
+                auto 同じ = [](auto a, auto b) {
+                    return a == b || (isnan(a) && isnan(b));
+                };
+                if (!同じ(新.加速度(), 旧.加速度()) ||
+                    !同じ(新.加加速度(), 旧.加加速度()))
+                {
+                    不一致数++;
+                }
+            }
+        }
+        if (不一致数 > 0) {
+            std::cerr << "加速度計 differs from the shifting average in "
+                << 不一致数 << " frames\n";
+            return false;
+        }
+
+        constexpr std::size_t 確認窓長 = 64;
+        {
+            加速度計 新;
+            新.設定(加速度計::推定方式::最小二乗, 確認窓長);
+            std::size_t 時刻逆行 = フレーム数 * 一括数 / 200;
+            for (std::size_t i = 0; i < 観測一覧.size(); i++) {
+                新.経過(観測一覧[i]);
+                // 時刻が戻った後は戻った時からの記録だけを使う
+                std::size_t 窓長 = i >= 時刻逆行 ?
+                    std::min(確認窓長, i + 1 - 時刻逆行) : 確認窓長;
+                mps2 期待値 = 直接最小二乗(観測一覧, i + 1, 窓長);
+                if (!(abs(新.加速度() - 期待値) <= 1e-9 * 1.0_mps2)) {
+                    不一致数++;
+                }
+            }
+        }
+        if (不一致数 > 0) {
+            std::cerr << "加速度計 (least squares) differs from the direct "
+                "fit in " << 不一致数 << " frames\n";
+            return false;
+        }
+
+        for (std::size_t 窓長 : {3, 30, 300, 3000}) {
+            ずらし加速度計 ずらし{窓長};
+            加速度計 差分平均, 最小二乗;
+            差分平均.設定(加速度計::推定方式::差分平均, 窓長);
+            最小二乗.設定(加速度計::推定方式::最小二乗, 窓長);
+            計測記録 ずらし記録, 差分平均記録, 最小二乗記録;
+            // 結果を使わないと計算ごと省かれるので足し合わせておく
+            mps2 ずらし合計{}, 差分平均合計{}, 最小二乗合計{};
+            for (std::size_t i = 0; i + 一括数 <= 観測一覧.size();
+                i += 一括数)
+            {
+                ずらし記録.計測([&] {
+                    for (std::size_t j = i; j < i + 一括数; j++) {
+                        ずらし.経過(観測一覧[j]);
+                        ずらし合計 += ずらし.加速度();
+                    }
+                });
+                差分平均記録.計測([&] {
+                    for (std::size_t j = i; j < i + 一括数; j++) {
+                        差分平均.経過(観測一覧[j]);
+                        差分平均合計 += 差分平均.加速度();
+                    }
+                });
+                最小二乗記録.計測([&] {
+                    for (std::size_t j = i; j < i + 一括数; j++) {
+                        最小二乗.経過(観測一覧[j]);
+                        最小二乗合計 += 最小二乗.加速度();
+                    }
+                });
+            }
+            if (!(ずらし合計 == 差分平均合計)) {
+                不一致数++;
+            }
+            int n = static_cast<int>(窓長);
+            ずらし記録.出力("加速度計::経過 x1000 (記録をずらす)", n);
+            差分平均記録.出力("加速度計::経過 x1000 (差分平均)", n);
+            最小二乗記録.出力("加速度計::経過 x1000 (最小二乗)", n);
+            std::cerr << "窓長 " << 窓長 << ": 速度雑音 "
+                << 最小二乗.速度雑音().value << " m/s, 平均加速度 "
+                << 最小二乗合計.value / static_cast<double>(観測一覧.size())
+                << " m/s/s\n";
+        }
+        if (不一致数 > 0) {
+            std::cerr << "加速度計 differs from the shifting average with "
+                "a wider window\n";
+            return false;
+        }
+        return true;
+    }
+
+    /// 以前の 制動力推定 と同じく、ブレーキシリンダー圧が落ち着いてから
+    /// 0.5 秒経つまでは基準最大減速度を使い、その後は推定値を一フレームに
+    /// 一定量ずつ実際の減速度に近づける
+    class 段階的制動力推定
+    {
+    public:
+        struct 観測
+        {
+            s 時刻;
+            mps 速度;
+            制動指令 ノッチ;
+            制動力割合 出力割合;
+            float ブレーキシリンダー圧;
+            float 電流;
+            mps2 出力減速度;
+        };
+
+        段階的制動力推定(mps2 基準最大減速度, s 反応時間) :
+            _基準最大減速度{基準最大減速度},
+            _推定最大減速度{基準最大減速度},
+            _反応時間{反応時間}
+        {
+        }
+
+        mps2 推定最大減速度() const { return _推定最大減速度; }
+
+        void 経過(const 観測 &今回)
+        {
+            if (_前回出力ノッチ != 今回.ノッチ) {
+                _前回出力ノッチ = 今回.ノッチ;
+                _前回出力ノッチ変化時刻 = 今回.時刻;
+            }
+
+            制動力割合 割合 = 今回.出力割合;
+            bool 割合安定 = 0.1 <= 割合.value && 割合.value <= 1.0;
+            if (割合安定 && 今回.電流 == 0 &&
+                abs(_前回出力ノッチ変化時刻 - 今回.時刻) >= _反応時間 &&
+                圧力差が小さい(_前回観測圧力, 今回.ブレーキシリンダー圧))
+            {
+                _推定最大圧力 = static_cast<float>(
+                    今回.ブレーキシリンダー圧 / 割合.value);
+            }
+            else {
+                割合 = 制動力割合{今回.ブレーキシリンダー圧 / _推定最大圧力};
+                割合安定 = 0.1 <= 割合.value && 割合.value <= 1.0;
+            }
+
+            if (!割合安定 || 今回.電流 != 0) {
+                _前回不安定時刻 = 今回.時刻;
+            }
+
+            if (今回.速度 >= static_cast<mps>(0.1_kmph)) {
+                if (abs(_前回不安定時刻 - 今回.時刻) >= 0.5_s) {
+                    s フレーム = 今回.時刻 - _前回観測時刻;
+                    if (0.0_s < フレーム && フレーム < 1.0_s &&
+                        今回.出力減速度 >= static_cast<mps2>(0.1_kmphps))
+                    {
+                        mps2 変化量上限 = 1.0_kmphps2 * フレーム;
+                        mps2 新推定値 = 今回.出力減速度 / 割合.value;
+                        _推定最大減速度 = std::clamp(新推定値,
+                            _推定最大減速度 - 変化量上限,
+                            _推定最大減速度 + 変化量上限);
+                    }
+                }
+                else {
+                    _推定最大減速度 = _基準最大減速度;
+                }
+            }
+
+            _前回観測圧力 = 今回.ブレーキシリンダー圧;
+            _前回観測時刻 = 今回.時刻;
+        }
+
+    private:
+        mps2 _基準最大減速度, _推定最大減速度;
+        s _反応時間;
+        float _推定最大圧力 = 440;
+        float _前回観測圧力 = 0;
+        制動指令 _前回出力ノッチ;
+        s _前回出力ノッチ変化時刻 = {};
+        s _前回不安定時刻 = {};
+        s _前回観測時刻 = {};
+
+        static bool 圧力差が小さい(float 圧力1, float 圧力2) {
+            if (圧力1 == 圧力2) {
+                return true;
+            }
+            float 比 = 圧力1 / 圧力2;
+            return 0.999f <= 比 && 比 <= 1 / 0.999f;
+        }
+    };
+
+    /// 駅と制限区間の手前で減速しながら走り、途中で車両のブレーキの効きを
+    /// 変えて、制動中に推定最大減速度が実際の値から 2% 以上ずれていた
+    /// フレーム数を以前の方法と比べる。最後の制動で推定値が実際の値に
+    /// 近づいていなければ失敗とする。
+    bool 制動力推定計測(int フレーム数, const std::wstring &設定ファイル名)
+    {
+        constexpr int 地上子間隔 = 300; // m
+        constexpr int 制限速度一覧[] = {90, 45, 100, 60};
+        constexpr int 停車時間 = 10 * 1000; // ms
+
+        static int 出力値[パネル数], 音声状態[音声数];
+        車両模型 車両;
+        Main main;
+        運転準備(main, 設定ファイル名);
+        main.地上子通過({1003, 0, 0, 30});
+        ATS_HANDLES ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+        main.キー押し(ATS_KEY_L);
+        main.キー放し(ATS_KEY_L);
+
+        const 共通状態 &状態 = main.状態();
+        段階的制動力推定 以前{
+            状態.制動().基準最大減速度(), 状態.制動().反応時間()};
+        int 受信済区切り = -1;
+        bool 停車予定 = false;
+        int 戸開時刻 = -1;
+        int 制動フレーム数[2] = {}, 以前の外れ数[2] = {}, 新しい外れ数[2] = {};
+        double 最後の誤差[2] = {};
+        for (int i = 1; i < フレーム数; i++) {
+            int 後半 = i >= フレーム数 / 2;
+            if (i == フレーム数 / 2) {
+                車両.制動力倍率設定(0.8); // 乗客が増えた
+            }
+
+            int 区切り = static_cast<int>(車両.状態().Location) / 地上子間隔;
+            for (; 受信済区切り < 区切り; 受信済区切り++) {
+                int k = 受信済区切り + 1;
+                int 速度 = 制限速度一覧[k % std::size(制限速度一覧)];
+                main.地上子通過({1006, 0, 0, 400 * 1000 + 速度});
+                if (k % 4 == 3) {
+                    main.地上子通過({1030, 0, 0, 400 * 1000});
+                    停車予定 = true;
+                }
+            }
+
+            int 時刻 = 車両.状態().Time;
+            if (停車予定 && 戸開時刻 < 0 && 車両.状態().Speed == 0) {
+                main.戸開();
+                戸開時刻 = 時刻;
+            }
+            else if (戸開時刻 >= 0 && 時刻 - 戸開時刻 >= 停車時間) {
+                main.戸閉();
+                停車予定 = false;
+                戸開時刻 = -1;
+            }
+
+            制動指令 ノッチ{ハンドル.Brake};
+            車両.走行(ハンドル, フレーム間隔);
+            ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+
+            // PressureRates を指定していないので各ノッチの制動力は等間隔
+            制動力割合 割合{
+                static_cast<double>(ノッチ.value) / 車両模型::仕様.BrakeNotches};
+            以前.経過({状態.現在時刻(), 状態.現在速度(), ノッチ, 割合,
+                状態.現在ブレーキシリンダー圧(), 状態.現在電流(),
+                状態.車両勾配加速度() - 状態.加速度()});
+
+            if (0 < ノッチ.value && ノッチ.value <= 車両模型::仕様.BrakeNotches
+                && 車両.状態().Speed > 0)
+            {
+                mps2 実際 = static_cast<mps2>(車両.常用最大減速度());
+                auto 外れ = [&](mps2 推定値) {
+                    return !(abs(推定値 - 実際) <= 0.02 * 実際);
+                };
+                制動フレーム数[後半]++;
+                以前の外れ数[後半] += 外れ(以前.推定最大減速度());
+                新しい外れ数[後半] += 外れ(状態.制動().推定最大減速度());
+                最後の誤差[後半] =
+                    (状態.制動().推定最大減速度() - 実際) / 実際;
+            }
+        }
+
+        for (int 後半 = 0; 後半 < 2; 後半++) {
+            std::cerr << "制動力推定 (" << (後半 ? "after" : "before")
+                << " load change): off by more than 2% in "
+                << 以前の外れ数[後半] << " (stepwise) and "
+                << 新しい外れ数[後半] << " (least squares) of "
+                << 制動フレーム数[後半] << " braking frames, final error "
+                << 最後の誤差[後半] * 100 << "%\n";
+        }
+        std::cerr << "制動力推定: estimated response time "
+            << 状態.制動().推定反応時間().value << " s (vehicle "
+            << 車両模型::応答時定数() << " s)\n";
+        // 推定値が落ち着くまでには何度か制動する必要がある
+        constexpr int 最少制動フレーム数 = 500; // 10 秒
+        if (制動フレーム数[0] < 最少制動フレーム数 ||
+            制動フレーム数[1] < 最少制動フレーム数)
+        {
+            std::cerr << "制動力推定: final error not checked, fewer than "
+                << 最少制動フレーム数 << " braking frames before or after "
+                "the load change (run with more frames)\n";
+            return true;
+        }
+        return std::abs(最後の誤差[0]) <= 0.02 && std::abs(最後の誤差[1]) <= 0.02;
+    }
+
+    /// 駅の手前で減速しながら走り、目標停止位置まで 800 m 以内の
+    /// フレームごとに停止予測の処理時間を計測する。残距離が 200, 100,
+    /// 50, 20 m を切った時の予測を実際の停止位置・ノッチを変えた回数と
+    /// 比べる。予測がメモリを確保するか、予測した停止位置が 1 m 以上
+    /// 外れた駅があれば失敗とする。
+    bool 停止予測計測(int フレーム数, const std::wstring &設定ファイル名)
+    {
+        constexpr int 地上子間隔 = 300; // m
+        constexpr int 制限速度一覧[] = {90, 45, 100, 60};
+        constexpr int 停車時間 = 10 * 1000; // ms
+        constexpr double 予測距離 = 800; // m
+        constexpr double 確認距離一覧[] = {200, 100, 50, 20}; // m
+        constexpr std::size_t 確認数 = std::size(確認距離一覧);
+
+        static int 出力値[パネル数], 音声状態[音声数];
+        車両模型 車両;
+        Main main;
+        運転準備(main, 設定ファイル名);
+        main.地上子通過({1003, 0, 0, 30});
+        ATS_HANDLES ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+        main.キー押し(ATS_KEY_L);
+        main.キー放し(ATS_KEY_L);
+
+        停止予測 予測;
+        予測.準備(main.状態());
+        計測記録 予測記録;
+        予測記録.予約(static_cast<std::size_t>(フレーム数));
+
+        // 確認距離ごとの、この駅での予測と、それ以降にノッチを変えた回数
+        struct 確認記録
+        {
+            bool 予測済 = false;
+            bool 停止する = false;
+            double 停止誤差 = 0;
+            int 予測ノッチ変化数 = 0, 実ノッチ変化数 = 0;
+        };
+        std::array<確認記録, 確認数> 駅記録{};
+        std::array<double, 確認数> 誤差差合計{}, 最大誤差差{};
+        std::array<int, 確認数> 予測変化合計{}, 実変化合計{}, 比較数{};
+        int 外れ数[確認数] = {}, 停止予測なし[確認数] = {};
+
+        int 受信済区切り = -1;
+        bool 停車予定 = false;
+        int 戸開時刻 = -1, 停車回数 = 0;
+        std::uint64_t 確保回数 = 0;
+        for (int i = 1; i < フレーム数; i++) {
+            int 区切り = static_cast<int>(車両.状態().Location) / 地上子間隔;
+            for (; 受信済区切り < 区切り; 受信済区切り++) {
+                int k = 受信済区切り + 1;
+                int 速度 = 制限速度一覧[k % std::size(制限速度一覧)];
+                main.地上子通過({1006, 0, 0, 400 * 1000 + 速度});
+                if (k % 4 == 3) {
+                    main.地上子通過({1030, 0, 0, 400 * 1000});
+                    停車予定 = true;
+                }
+            }
+
+            int 時刻 = 車両.状態().Time;
+            if (停車予定 && 戸開時刻 < 0 && 車両.状態().Speed == 0) {
+                double 実誤差 = main.状態().現在位置().value -
+                    main.tasc状態().目標停止位置().value;
+                for (std::size_t j = 0; j < 確認数; j++) {
+                    const 確認記録 &記録 = 駅記録[j];
+                    if (!記録.予測済) {
+                        continue;
+                    }
+                    if (!記録.停止する) {
+                        停止予測なし[j]++;
+                        continue;
+                    }
+                    double 差 = std::abs(記録.停止誤差 - 実誤差);
+                    誤差差合計[j] += 差;
+                    最大誤差差[j] = std::max(最大誤差差[j], 差);
+                    外れ数[j] += 差 >= 1.0;
+                    予測変化合計[j] += 記録.予測ノッチ変化数;
+                    実変化合計[j] += 記録.実ノッチ変化数;
+                    比較数[j]++;
+                }
+                駅記録 = {};
+                main.戸開();
+                戸開時刻 = 時刻;
+                停車回数++;
+            }
+            else if (戸開時刻 >= 0 && 時刻 - 戸開時刻 >= 停車時間) {
+                main.戸閉();
+                停車予定 = false;
+                戸開時刻 = -1;
+            }
+
+            ATS_HANDLES 前回 = ハンドル;
+            車両.走行(ハンドル, フレーム間隔);
+            ハンドル = main.経過(車両.状態(), 出力値, 音声状態);
+            bool 変化 = ハンドル.Brake != 前回.Brake ||
+                ハンドル.Power != 前回.Power;
+            for (確認記録 &記録 : 駅記録) {
+                記録.実ノッチ変化数 += 記録.予測済 && 変化;
+            }
+
+            const 共通状態 &状態 = main.状態();
+            double 残距離 = main.tasc状態().目標停止位置().value -
+                状態.現在位置().value;
+            if (!main.tasc状態().制御中() || 状態.停車中() ||
+                !(残距離 <= 予測距離))
+            {
+                continue;
+            }
+            std::uint64_t 開始時確保回数 = メモリ確保回数;
+            予測記録.計測([&] {
+                予測.予測(状態, main.tasc状態(), main.ato有効());
+            });
+            確保回数 += メモリ確保回数 - 開始時確保回数;
+            for (std::size_t j = 0; j < 確認数; j++) {
+                確認記録 &記録 = 駅記録[j];
+                if (!記録.予測済 && 残距離 < 確認距離一覧[j]) {
+                    記録.予測済 = true;
+                    記録.停止する = 予測.停止する();
+                    記録.停止誤差 = 予測.停止誤差().value;
+                    記録.予測ノッチ変化数 = 予測.ノッチ変化数();
+                }
+            }
+        }
+
+        予測記録.出力("停止予測::予測", 停車回数);
+        if (停車回数 == 0) {
+            std::cerr << "停止予測: accuracy not checked, " << フレーム数
+                << " frames end before the first stop (run with more "
+                "frames); " << 確保回数 << " allocations\n";
+            return 確保回数 == 0;
+        }
+        bool 成功 = 確保回数 == 0;
+        for (std::size_t j = 0; j < 確認数; j++) {
+            std::cerr << "停止予測 at " << 確認距離一覧[j] << " m: ";
+            if (比較数[j] == 0) {
+                std::cerr << "no prediction\n";
+                成功 = false;
+                continue;
+            }
+            std::cerr << "stop position off by " << 誤差差合計[j] / 比較数[j]
+                << " m on average (max " << 最大誤差差[j] << " m, "
+                << 外れ数[j] << " of " << 比較数[j] << " stops over 1 m, "
+                << 停止予測なし[j] << " not stopping), "
+                << static_cast<double>(予測変化合計[j]) / 比較数[j]
+                << " notch changes predicted vs "
+                << static_cast<double>(実変化合計[j]) / 比較数[j]
+                << " actual\n";
+            成功 = 成功 && 外れ数[j] == 0 && 停止予測なし[j] == 0;
+        }
+        std::cerr << "停止予測: " << 確保回数 << " allocations in "
+            << 停車回数 << " stops\n";
+        return 成功;
+    }
+
+    /// 合成路線の途中で状態を保存し、そこから後半をもう一度走る。
+    /// 同じ Main に復元した場合も、作り直した Main に復元した場合も
+    /// 後半の出力が最初の走行と一致することを確かめる。保存・復元の
+    /// 処理時間を、前半を最初から走り直す時間と比べる。
+    bool 状態保存計測(
+        int n, int フレーム数, const std::wstring &設定ファイル名)
+    {
+        constexpr int 復元回数 = 100;
+        路線設定 設定;
+        設定.制限区間数 = 設定.閉塞数 = 設定.予定数 = 設定.勾配数 = n;
+        std::vector<ATS_BEACONDATA> 地上子一覧 = 路線地上子(設定);
+
+        struct 出力記録
+        {
+            std::vector<ATS_HANDLES> ハンドル;
+            std::vector<int> パネル, 音声;
+        };
+        // 保存した時点の Main 以外の状態 (車両と出力先)
+        struct 外部状態
+        {
+            車両模型 車両;
+            ATS_HANDLES ハンドル;
+            std::array<int, パネル数> 出力値;
+            std::array<int, 音声数> 音声状態;
+        };
+        auto 後半を走る = [&](Main &main, 外部状態 状態, 出力記録 &記録) {
+            for (int i = フレーム数 / 2; i < フレーム数; i++) {
+                状態.車両.走行(状態.ハンドル, フレーム間隔);
+                状態.ハンドル = main.経過(状態.車両.状態(),
+                    状態.出力値.data(), 状態.音声状態.data());
+                記録.ハンドル.push_back(状態.ハンドル);
+                記録.パネル.insert(記録.パネル.end(),
+                    状態.出力値.begin(), 状態.出力値.end());
+                記録.音声.insert(記録.音声.end(),
+                    状態.音声状態.begin(), 状態.音声状態.end());
+            }
+        };
+        auto 同じ = [](const 出力記録 &a, const 出力記録 &b) {
+            return a.パネル == b.パネル && a.音声 == b.音声 &&
+                std::equal(a.ハンドル.begin(), a.ハンドル.end(),
+                    b.ハンドル.begin(), b.ハンドル.end(),
+                    [](const ATS_HANDLES &x, const ATS_HANDLES &y) {
+                        return x.Brake == y.Brake && x.Power == y.Power &&
+                            x.Reverser == y.Reverser;
+                    });
+        };
+
+        計測記録 前半記録, 保存記録, 復元記録;
+        std::vector<unsigned char> 保存状態;
+        外部状態 保存時{};
+        出力記録 最初, 巻戻し, 別のmain;
+        Main main;
+        前半記録.計測([&] {
+            運転準備(main, 設定ファイル名);
+            保存時.ハンドル = main.経過(保存時.車両.状態(),
+                保存時.出力値.data(), 保存時.音声状態.data());
+            for (const ATS_BEACONDATA &地上子 : 地上子一覧) {
+                main.地上子通過(地上子);
+            }
+            main.キー押し(ATS_KEY_L);
+            main.キー放し(ATS_KEY_L);
+            for (int i = 1; i < フレーム数 / 2; i++) {
+                保存時.車両.走行(保存時.ハンドル, フレーム間隔);
+                保存時.ハンドル = main.経過(保存時.車両.状態(),
+                    保存時.出力値.data(), 保存時.音声状態.data());
+            }
+        });
+        for (int i = 0; i < 復元回数; i++) {
+            保存記録.計測([&] { main.状態保存(保存状態); });
+        }
+        後半を走る(main, 保存時, 最初);
+
+        for (int i = 0; i < 復元回数; i++) {
+            復元記録.計測([&] { main.状態復元(保存状態); });
+        }
+        後半を走る(main, 保存時, 巻戻し);
+
+        Main 新しいmain;
+        運転準備(新しいmain, 設定ファイル名);
+        新しいmain.状態復元(保存状態);
+        後半を走る(新しいmain, 保存時, 別のmain);
+
+        前半記録.出力("Main::経過 (前半を走り直す)", n);
+        保存記録.出力("Main::状態保存", n);
+        復元記録.出力("Main::状態復元", n);
+        std::cerr << "N = " << n << ": snapshot is " << 保存状態.size()
+            << " bytes\n";
+        if (!同じ(最初, 巻戻し) || !同じ(最初, 別のmain)) {
+            std::cerr << "N = " << n << ": running again from a restored "
+                "snapshot gives different output\n";
+            return false;
+        }
+        return true;
+    }
+
+    void キャッシュ効果出力(
+        int n, const char *名前, const 共通状態::キャッシュ統計 &統計)
+    {
+        std::cerr << "N = " << n << ": 共通状態::" << 名前 << " computed "
+            << 統計.計算回数 << " times, reused " << 統計.再利用回数
+            << " times\n";
+    }
+
+    int 使い方()
+    {
+        std::cerr << "usage: autopilot-bench [-n count]... [-f frames]\n";
+        return 2;
+    }
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> 個数一覧;
+    int フレーム数 = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            int n = std::atoi(argv[++i]);
+            if (n < 0) {
+                return 使い方();
+            }
+            個数一覧.push_back(n);
+        }
+        else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            フレーム数 = std::atoi(argv[++i]);
+            if (フレーム数 < 2) {
+                return 使い方();
+            }
+        }
+        else {
+            return 使い方();
+        }
+    }
+    if (個数一覧.empty()) {
+        個数一覧 = {10, 100, 500};
+    }
+
+    std::filesystem::path 設定ファイル =
+        std::filesystem::temp_directory_path() / "autopilot-bench.ini";
+    {
+        std::ofstream 出力{設定ファイル, std::ios::binary};
+        出力 << 設定内容;
+    }
+    std::wstring 設定ファイル名 = 設定ファイル.wstring();
+    std::filesystem::path 全パネル設定ファイル =
+        std::filesystem::temp_directory_path() / "autopilot-bench-panel.ini";
+    {
+        std::ofstream 出力{全パネル設定ファイル, std::ios::binary};
+        出力 << 全パネル設定内容();
+    }
+    std::wstring 全パネル設定ファイル名 = 全パネル設定ファイル.wstring();
+
+    std::printf("case\tN\tframes\tp50_ns\tp99_ns\tmax_ns\n");
+    bool 一致 = true;
+    for (int n : 個数一覧) {
+        路線設定 設定;
+        設定.制限区間数 = 設定.閉塞数 = 設定.予定数 = 設定.勾配数 = n;
+        std::vector<ATS_BEACONDATA> 地上子一覧 = 路線地上子(設定);
+
+        計測記録 全体記録;
+        軌跡 軌跡 = 全体計測(地上子一覧, フレーム数, 設定ファイル名, 全体記録);
+        全体記録.出力("Main::経過", n);
+        一致 = 部品計測(地上子一覧, 軌跡, n) && 一致;
+        一致 = 等加加速度計測(軌跡, n) && 一致;
+        一致 = 期待速度一括計測(軌跡, n) && 一致;
+
+        計測記録 全パネル記録, パネル出力記録;
+        auto 全パネル軌跡 = 全体計測(地上子一覧, フレーム数,
+            全パネル設定ファイル名, 全パネル記録, &パネル出力記録);
+        全パネル記録.出力("Main::経過 (パネル 256 個)", n);
+        パネル出力記録.出力("Main::パネル出力 (256 個)", n);
+
+        計測記録 山岳線記録;
+        auto 山岳線軌跡 = 全体計測(路線地上子(山岳線(n)), フレーム数,
+            設定ファイル名, 山岳線記録);
+        山岳線記録.出力("Main::経過 (山岳線)", n);
+        一致 = 山岳線勾配計測(山岳線軌跡, n) && 一致;
+        一致 = 状態保存計測(n, フレーム数, 設定ファイル名) && 一致;
+
+        const ATS_VEHICLESTATE &最終状態 = 軌跡.状態.back();
+        std::fflush(stdout);
+        std::cerr << "N = " << n << ": ran " << 最終状態.Location
+            << " m in " << (最終状態.Time - 車両模型::開始時刻) / 1000
+            << " s\n";
+        キャッシュ効果出力(n, "車両勾配加速度",
+            軌跡.キャッシュ効果.車両勾配加速度);
+        キャッシュ効果出力(n, "前回自動制動ノッチ",
+            軌跡.キャッシュ効果.前回自動制動ノッチ);
+        std::cerr << "N = " << n << ": " << static_cast<double>(
+            全パネル軌跡.パネル変化数) / 全パネル軌跡.状態.size()
+            << " of 256 panel outputs changed per frame\n";
+    }
+
+    計測記録 閉塞記録;
+    全体計測(路線地上子(閉塞路線()), フレーム数, 設定ファイル名, 閉塞記録);
+    閉塞記録.出力("Main::経過 (閉塞)", 閉塞路線().閉塞数);
+    一致 = 閉塞計測(5) && 一致;
+    地上子振り分け計測(フレーム数);
+    一致 = 加速度計計測(フレーム数) && 一致;
+    一致 = 制動力推定計測(フレーム数 * 30, 設定ファイル名) && 一致;
+    一致 = 停止予測計測(フレーム数 * 30, 設定ファイル名) && 一致;
+    一致 = 定常走行メモリ確保計測(フレーム数 * 30, 全パネル設定ファイル名) && 一致;
+
+    std::error_code ec;
+    std::filesystem::remove(設定ファイル, ec);
+    std::filesystem::remove(全パネル設定ファイル, ec);
+    return 一致 ? 0 : 1;
+}
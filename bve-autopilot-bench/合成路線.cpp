@@ -0,0 +1,171 @@
+// 合成路線.cpp : 性能計測用に機械的に生成した路線と車両です
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+#include "合成路線.h"
+#include <algorithm>
+#include <cmath>
+
+namespace autopilot
+{
+
+    namespace
+    {
+
+        constexpr int 制限速度一覧[] = {120, 90, 60, 100, 75};
+        constexpr int 信号一覧[] = {5, 4, 5, 3}; // 160, 85, 160, 65 km/h
+        constexpr int 照査速度一覧[] = {0, 15, 25}; // km/h
+        constexpr int 勾配一覧[] = {0, 15, 25, -10, -33, 5}; // ‰
+
+        constexpr double 最大加速度 = 3.0 / 3.6;
+        constexpr double 最大減速度 = 3.5 / 3.6;
+        constexpr double 非常減速度 = 4.5 / 3.6;
+        constexpr double 最高速度 = 130.0 / 3.6;
+        constexpr double 加速度応答時定数 = 0.3; // s
+        // 空走時間は設定ファイルの反応時間 (既定 0.2 s) とわざと変えておく
+        constexpr double 制動空走時間 = 0.3; // s
+        constexpr double 圧力応答時定数 = 0.5; // s
+        constexpr float 最大圧力 = 440;
+
+        ATS_BEACONDATA 地上子(int 種類, int 値, int 信号 = 0, float 距離 = 0)
+        {
+            return ATS_BEACONDATA{種類, 信号, 距離, 値};
+        }
+
+    }
+
+    std::vector<ATS_BEACONDATA> 路線地上子(const 路線設定 &設定)
+    {
+        std::vector<ATS_BEACONDATA> 一覧;
+        int 間隔 = 設定.間隔;
+
+        for (int i = 0; i < 設定.制限区間数; i++) {
+            int 速度 = 制限速度一覧[i % std::size(制限速度一覧)];
+            一覧.push_back(地上子(1006, (i + 1) * 間隔 * 1000 + 速度));
+        }
+        for (int i = 0; i < 設定.閉塞数; i++) {
+            int 信号 = 信号一覧[i % std::size(信号一覧)];
+            float 距離 = static_cast<float>((i + 1) * 間隔);
+            一覧.push_back(地上子(1012, 0, 信号, 距離));
+            for (int j = 0; j < 設定.停止信号前照査数; j++) {
+                // 閉塞境界の手前 10 m から 40 m おきに並べる
+                int 位置 = (i + 1) * 間隔 - 10 - 40 * j;
+                int 速度 = 照査速度一覧[j % std::size(照査速度一覧)];
+                一覧.push_back(地上子(1016, 位置 * 1000 + 速度, 信号, 距離));
+            }
+        }
+        for (int i = 0; i < 設定.予定数; i++) {
+            // 表定速度 25 m/s 程度に合わせる
+            int 位置 = (i + 1) * 間隔;
+            int 時刻 = 車両模型::開始時刻 / 1000 + 30 + 位置 / 25;
+            一覧.push_back(地上子(1028, 時刻));
+            一覧.push_back(地上子(1029, 位置 * 1000 + 50));
+        }
+        int 勾配間隔 = 設定.勾配間隔 > 0 ? 設定.勾配間隔 : 間隔;
+        for (int i = 0; i < 設定.勾配数; i++) {
+            int 勾配 = 勾配一覧[i % std::size(勾配一覧)];
+            int 値 = (i + 1) * 勾配間隔 * 1000 + std::abs(勾配);
+            一覧.push_back(地上子(1008, 勾配 < 0 ? -値 : 値));
+        }
+
+        int 路線長 = std::max({
+            std::max({設定.制限区間数, 設定.閉塞数, 設定.予定数, 1}) * 間隔,
+            設定.勾配数 * 勾配間隔}) + 間隔;
+        一覧.push_back(地上子(1030, 路線長 * 1000));
+        return 一覧;
+    }
+
+    車両模型::車両模型() :
+        _状態{}, _速度{0}, _力行加速度{0}, _圧力割合{0}, _指令記録{},
+        _指令先頭{0}, _指令個数{0}, _効いている指令{0}
+    {
+        _状態.Time = 開始時刻;
+    }
+
+    double 車両模型::常用最大減速度() const
+    {
+        return 最大減速度 * _制動力倍率;
+    }
+
+    double 車両模型::空走時間()
+    {
+        return 制動空走時間;
+    }
+
+    double 車両模型::応答時定数()
+    {
+        return 圧力応答時定数;
+    }
+
+    void 車両模型::走行(const ATS_HANDLES &ハンドル, int 時間)
+    {
+        double 目標力行加速度 = 0;
+        double 圧力割合 = 0;
+        if (ハンドル.Brake > 仕様.BrakeNotches) {
+            // 非常ブレーキはシリンダー圧を常用最大より高くして効かせる
+            圧力割合 = 非常減速度 / 最大減速度;
+        }
+        else if (ハンドル.Brake > 0) {
+            圧力割合 = static_cast<double>(ハンドル.Brake) / 仕様.BrakeNotches;
+        }
+        else if (ハンドル.Power > 0 && ハンドル.Reverser > 0) {
+            目標力行加速度 = 最大加速度 * ハンドル.Power / 仕様.PowerNotches *
+                std::max(0.0, 1 - _速度 / 最高速度);
+        }
+
+        // 指令は空走時間だけ遅れてシリンダー圧に伝わる
+        const 制動指令記録 *最新 = _指令個数 > 0 ?
+            &_指令記録[(_指令先頭 + _指令個数 - 1) % 指令記録数] : nullptr;
+        double 最新指令 = 最新 ? 最新->圧力割合 : _効いている指令;
+        if (圧力割合 != 最新指令) {
+            if (_指令個数 == 指令記録数) {
+                _効いている指令 = _指令記録[_指令先頭].圧力割合;
+                _指令先頭 = (_指令先頭 + 1) % 指令記録数;
+                _指令個数--;
+            }
+            _指令記録[(_指令先頭 + _指令個数) % 指令記録数] =
+                {_状態.Time, 圧力割合};
+            _指令個数++;
+        }
+        int 空走ms = static_cast<int>(std::lround(制動空走時間 * 1000));
+        while (_指令個数 > 0 &&
+            _指令記録[_指令先頭].時刻 + 空走ms <= _状態.Time + 時間)
+        {
+            _効いている指令 = _指令記録[_指令先頭].圧力割合;
+            _指令先頭 = (_指令先頭 + 1) % 指令記録数;
+            _指令個数--;
+        }
+
+        double 秒 = 時間 / 1000.0;
+        _力行加速度 += (目標力行加速度 - _力行加速度) *
+            std::min(1.0, 秒 / 加速度応答時定数);
+        _圧力割合 += (_効いている指令 - _圧力割合) *
+            std::min(1.0, 秒 / 圧力応答時定数);
+        double 加速度 = _力行加速度 - 常用最大減速度() * _圧力割合;
+        double 新速度 = std::max(0.0, _速度 + 加速度 * 秒);
+        _状態.Location += (_速度 + 新速度) / 2 * 秒;
+        _速度 = 新速度;
+        _状態.Speed = static_cast<float>(_速度 * 3.6);
+        _状態.Time += 時間;
+        _状態.BcPressure = static_cast<float>(最大圧力 * _圧力割合);
+        _状態.Current = ハンドル.Power > 0 && 圧力割合 == 0 ?
+            static_cast<float>(100 * ハンドル.Power) : 0.0f;
+    }
+
+}
@@ -0,0 +1,92 @@
+// 合成路線.h : 性能計測用に機械的に生成した路線と車両です
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace autopilot
+{
+
+    struct 路線設定
+    {
+        int 制限区間数 = 0;
+        int 閉塞数 = 0;
+        int 予定数 = 0;
+        int 勾配数 = 0;
+        /// 各閉塞の手前に置く停止信号前照査 (1016) の数
+        int 停止信号前照査数 = 0;
+        /// 制限区間・閉塞・予定・勾配はそれぞれこの間隔で並べる (m)
+        int 間隔 = 1000;
+        /// 0 でなければ勾配だけはこの間隔で並べる (山岳線用, m)
+        int 勾配間隔 = 0;
+    };
+
+    /// 路線の始点で全て受信する地上子の一覧を返します。
+    /// 制限区間 (1006)、閉塞 (1012)、停止信号前照査 (1016)、
+    /// 予定 (1028, 1029)、勾配 (1008) と路線の終点の停止位置 (1030) を
+    /// 含みます。
+    std::vector<ATS_BEACONDATA> 路線地上子(const 路線設定 &設定);
+
+    /// BVE 本体の代わりにハンドル操作に応じて走行する簡単な車両です。
+    class 車両模型
+    {
+    public:
+        static constexpr ATS_VEHICLESPEC 仕様 = {8, 5, 1, 6, 10};
+        static constexpr int 開始時刻 = 10 * 60 * 60 * 1000; // ms
+
+        車両模型();
+
+        const ATS_VEHICLESTATE &状態() const { return _状態; }
+
+        /// 指定したハンドル位置で一定時間走行します。
+        void 走行(const ATS_HANDLES &ハンドル, int 時間);
+
+        /// 乗車率の変化などで常用ブレーキの効きを変えます。
+        void 制動力倍率設定(double 倍率) { _制動力倍率 = 倍率; }
+        /// 最大常用ブレーキの実際の減速度 (m/s/s)
+        double 常用最大減速度() const;
+        /// ブレーキ指令からブレーキシリンダー圧が動き始めるまでの時間 (s)
+        static double 空走時間();
+        /// ブレーキシリンダー圧が指令に追従する一次遅れの時定数 (s)。
+        /// 減速度はシリンダー圧に比例する
+        static double 応答時定数();
+
+    private:
+        /// 空走時間の間の指令を覚えておく数
+        static constexpr std::size_t 指令記録数 = 64;
+        struct 制動指令記録 {
+            int 時刻; // ms
+            double 圧力割合; // 最大常用ブレーキに対する比
+        };
+
+        ATS_VEHICLESTATE _状態;
+        double _速度; // m/s
+        double _力行加速度; // m/s/s
+        /// 実際のブレーキシリンダー圧の最大常用ブレーキに対する比
+        double _圧力割合;
+        double _制動力倍率 = 1;
+        /// 古い順に _指令先頭 から _指令個数 個並ぶ環状の配列
+        std::array<制動指令記録, 指令記録数> _指令記録;
+        std::size_t _指令先頭, _指令個数;
+        double _効いている指令; // 空走時間を過ぎた指令の圧力割合
+    };
+
+}
@@ -0,0 +1,207 @@
+// replay.cpp : 記録した呼出しをシミュレーターなしで再生します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+// 使い方: autopilot-replay [-c 設定ファイル] [-p 計測結果] [-q] 記録ファイル
+//
+// 記録ファイルに含まれる呼出しを順に autopilot::Main に与え、Elapse の
+// 度に出力したノッチをタブ区切りで標準出力に書き出す。-q を指定すると
+// フレームごとの出力を省略し、最後の集計だけを標準エラーに書き出す。
+// AUTOPILOT_PROFILE を有効にしてビルドした場合は -p で指定したファイルに
+// Dispose の度に各部の処理時間を書き出す。
+
+#include "stdafx.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "Main.h"
+#include "処理時間計測.h"
+#include "呼出記録.h"
+
+namespace
+{
+
+    constexpr int パネル数 = 256;
+    constexpr int 音声数 = 256;
+
+    struct 再生状態
+    {
+        std::unique_ptr<autopilot::Main> main;
+        std::wstring 設定ファイル名;
+        std::filesystem::path 計測結果ファイル名;
+        int 出力値[パネル数] = {};
+        int 音声状態[音声数] = {};
+        unsigned long long フレーム数 = 0;
+        bool 出力する = true;
+    };
+
+    void 出力(const 再生状態 &状態, const ATS_VEHICLESTATE &車両状態,
+        const ATS_HANDLES &ハンドル)
+    {
+        std::printf("%llu\t%d\t%.3f\t%.2f\t%d\t%d\t%d\n",
+            状態.フレーム数, 車両状態.Time, 車両状態.Location,
+            static_cast<double>(車両状態.Speed),
+            ハンドル.Brake, ハンドル.Power, ハンドル.Reverser);
+    }
+
+    void 実行(再生状態 &状態, const autopilot::呼出 &呼出)
+    {
+        using autopilot::呼出種別;
+
+        if (呼出.種別 == 呼出種別::Load) {
+            状態.main = std::make_unique<autopilot::Main>();
+            return;
+        }
+        if (状態.main == nullptr) {
+            return; // Load 前の呼出しは DLL と同様に無視する
+        }
+
+        autopilot::Main &main = *状態.main;
+        switch (呼出.種別) {
+        case 呼出種別::Dispose:
+            状態.main = nullptr;
+            if (autopilot::処理時間計測::有効 &&
+                !状態.計測結果ファイル名.empty())
+            {
+                std::ofstream 計測結果{状態.計測結果ファイル名};
+                autopilot::処理時間計測::記録.書出(計測結果);
+            }
+            autopilot::処理時間計測::記録.リセット();
+            break;
+        case 呼出種別::SetVehicleSpec:
+            main.設定ファイル読込(状態.設定ファイル名.c_str());
+            main.車両仕様設定(呼出.車両仕様);
+            break;
+        case 呼出種別::Initialize:
+            main.リセット(呼出.引数);
+            break;
+        case 呼出種別::Elapse: {
+            ATS_HANDLES ハンドル = main.経過(
+                呼出.車両状態, 状態.出力値, 状態.音声状態);
+            if (状態.出力する) {
+                出力(状態, 呼出.車両状態, ハンドル);
+            }
+            状態.フレーム数++;
+            break;
+        }
+        case 呼出種別::SetPower:
+            main.力行操作(呼出.引数);
+            break;
+        case 呼出種別::SetBrake:
+            main.制動操作(呼出.引数);
+            break;
+        case 呼出種別::SetReverser:
+            main.逆転器操作(呼出.引数);
+            break;
+        case 呼出種別::KeyDown:
+            main.キー押し(呼出.引数);
+            break;
+        case 呼出種別::KeyUp:
+            main.キー放し(呼出.引数);
+            break;
+        case 呼出種別::HornBlow:
+            main.警笛操作(呼出.引数);
+            break;
+        case 呼出種別::DoorOpen:
+            main.戸開();
+            break;
+        case 呼出種別::DoorClose:
+            main.戸閉();
+            break;
+        case 呼出種別::SetSignal:
+            main.信号現示変化(呼出.引数);
+            break;
+        case 呼出種別::SetBeaconData:
+            main.地上子通過(呼出.地上子);
+            break;
+        case 呼出種別::Load:
+            break;
+        }
+    }
+
+    int 使い方()
+    {
+        std::cerr <<
+            "usage: autopilot-replay [-c config.ini] [-p profile.tsv] [-q] "
+            "trace-file\n";
+        return 2;
+    }
+
+}
+
+int main(int argc, char *argv[])
+{
+    再生状態 状態;
+    const char *記録ファイル名 = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            状態.設定ファイル名 =
+                std::filesystem::path{argv[++i]}.wstring();
+        }
+        else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            状態.計測結果ファイル名 = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-q") == 0) {
+            状態.出力する = false;
+        }
+        else if (記録ファイル名 == nullptr && argv[i][0] != '-') {
+            記録ファイル名 = argv[i];
+        }
+        else {
+            return 使い方();
+        }
+    }
+    if (記録ファイル名 == nullptr) {
+        return 使い方();
+    }
+
+    std::ifstream 記録ファイル{記録ファイル名, std::ios::binary};
+    if (!記録ファイル) {
+        std::cerr << 記録ファイル名 << ": cannot open\n";
+        return 1;
+    }
+
+    try {
+        auto 開始 = std::chrono::steady_clock::now();
+
+        autopilot::呼出記録読込 読込{記録ファイル};
+        autopilot::呼出 呼出;
+        while (読込.読込(呼出)) {
+            実行(状態, 呼出);
+        }
+
+        std::chrono::duration<double> 経過時間 =
+            std::chrono::steady_clock::now() - 開始;
+        std::fflush(stdout);
+        std::cerr << 状態.フレーム数 << " frames in "
+            << 経過時間.count() << " s\n";
+    }
+    catch (const std::exception &e) {
+        std::fflush(stdout);
+        std::cerr << 記録ファイル名 << ": " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -20,8 +20,13 @@
 #include "stdafx.h"
 #include "Main.h"
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <limits>
+#include <stdexcept>
+#include "処理時間計測.h"
+#include "状態保存.h"
 
 namespace autopilot
 {
@@ -44,27 +49,6 @@ namespace autopilot
                 全て押している(新キー組合せ, 目標キー組合せ);
         }
 
-        制動指令 出力制動指令(
-            手動制動自然数ノッチ 手動ノッチ, 自動制動自然数ノッチ 自動ノッチ,
-            const 制動特性 &制動)
-        {
-            if (制動.非常ブレーキである(手動ノッチ)) {
-                return 手動ノッチ; // 非常ブレーキは常に優先する
-            }
-            if (自動ノッチ == 自動制動自然数ノッチ{0}) {
-                return 手動ノッチ;
-            }
-
-            mps2 手動 = 制動.減速度(手動ノッチ);
-            mps2 自動 = 制動.減速度(自動ノッチ);
-            if (手動 >= 自動) {
-                return 手動ノッチ;
-            }
-            else {
-                return 制動.指令(自動ノッチ);
-            }
-        }
-
     }
 
     Main::Main() :
@@ -79,6 +63,19 @@ namespace autopilot
         _tasc.目標停止位置を監視([&](区間 位置のある範囲) {
             _ato.tasc目標停止位置変化(位置のある範囲);
         });
+
+        static_assert(static_cast<int>(互換モード型::無効) == 0);
+        for (auto モード : {
+            互換モード型::無効, 互換モード型::汎用ats,
+            互換モード型::メトロ総合, 互換モード型::swp2})
+        {
+            地上子振り分け &振り分け =
+                _地上子振り分け[static_cast<std::size_t>(モード)];
+            // 同じ地上子はこの順に処理する
+            _状態.地上子処理登録(振り分け);
+            _tasc.地上子処理登録(振り分け, モード);
+            _ato.地上子処理登録(振り分け, モード);
+        }
     }
 
     Main::~Main()
@@ -88,17 +85,17 @@ namespace autopilot
 
     mps Main::現在制限速度() const
     {
-        return _ato.現在制限速度(_状態);
+        return _ato.現在制限速度状況().制限速度;
     }
 
     mps Main::現在常用パターン速度() const
     {
-        return _ato.現在常用パターン速度(_状態);
+        return _ato.現在制限速度状況().常用パターン速度;
     }
 
     mps Main::現在orp照査速度() const
     {
-        return _ato.現在orp照査速度();
+        return _ato.現在制限速度状況().orp照査速度;
     }
 
     void Main::リセット(int)
@@ -201,17 +198,36 @@ namespace autopilot
     ATS_HANDLES Main::経過(
         const ATS_VEHICLESTATE &状態, int *出力値, int *音声状態)
     {
+        処理時間計測::記録.フレーム開始(状態.Time);
+        計測区間 計測{計測区分::全体};
+
         m 直前位置 = _状態.現在位置();
-        _状態.経過(状態);
-        地上子通過執行(直前位置);
+        {
+            計測区間 計測{計測区分::共通状態};
+            _状態.経過(状態);
+        }
+        {
+            計測区間 計測{計測区分::地上子通過執行};
+            地上子通過執行(直前位置);
+        }
 
         // ATO 自動発進
         if (_ato有効 && _状態.自動発進可能な時刻である()) {
             _ato.発進(_状態, ato::発進方式::自動);
         }
 
-        _tasc.経過(_状態);
-        _ato.経過(_状態);
+        {
+            計測区間 計測{計測区分::tasc};
+            _tasc.経過(_状態);
+        }
+        {
+            計測区間 計測{計測区分::ato};
+            _ato.経過(_状態);
+        }
+        if (_状態.設定().パネル出力割当().制限速度状況使用()) {
+            計測区間 計測{計測区分::制限グラフ};
+            _ato.制限速度状況更新(_状態);
+        }
 
         // TASC と ATO の出力ノッチをまとめる
         自動制御指令 自動ノッチ = _状態.最大力行ノッチ();
@@ -222,33 +238,35 @@ namespace autopilot
             自動ノッチ = std::min(自動ノッチ, _ato.出力ノッチ());
         }
 
-        if (!_ato有効 || _状態.入力制動ノッチ() > 手動制動自然数ノッチ{0} ||
-            _状態.入力逆転器ノッチ() <= 0)
-        {
+        if (!_ato有効) {
             自動ノッチ = std::min(自動ノッチ, 自動制御指令{力行ノッチ{0}});
         }
 
-        ATS_HANDLES ハンドル位置;
-        ハンドル位置.Brake = 出力制動指令(
-            _状態.入力制動ノッチ(), 自動ノッチ.制動成分(), _状態.制動()).value;
-        if (_状態.入力力行ノッチ() >= 0) {
-            ハンドル位置.Power = std::max(
-                static_cast<int>(自動ノッチ.力行成分().value),
-                _状態.入力力行ノッチ());
+        ATS_HANDLES ハンドル位置 = _状態.出力ハンドル位置(自動ノッチ);
+        _状態.出力(ハンドル位置);
+
+        if (_tasc有効 && _tasc.制御中() &&
+            _状態.設定().パネル出力割当().停止予測使用())
+        {
+            計測区間 計測{計測区分::停止予測};
+            _停止予測.予測(_状態, _tasc, _ato有効);
         }
         else {
-            ハンドル位置.Power = _状態.入力力行ノッチ();
+            _停止予測.消去();
         }
-        ハンドル位置.Reverser = _状態.入力逆転器ノッチ();
-        ハンドル位置.ConstantSpeed = ATS_CONSTANTSPEED_CONTINUE;
 
-        _状態.出力(ハンドル位置);
-
-        for (auto パネル出力 : _状態.設定().パネル出力対象登録簿()) {
-            出力値[パネル出力.first] = パネル出力.second.出力(*this);
+        {
+            計測区間 計測{計測区分::パネル出力};
+            _パネル変化数 = パネル出力(出力値);
         }
+        // パネルと同じく、値が変わった出力先だけ書き換える
+        _音声変化数 = 0;
         for (const auto &i : _状態.設定().音声割り当て()) {
-            音声状態[i.second] = _音声状態[i.first].出力();
+            int 値 = _音声状態[i.first].出力();
+            if (音声状態[i.second] != 値) {
+                音声状態[i.second] = 値;
+                _音声変化数++;
+            }
         }
 
         return ハンドル位置;
@@ -257,12 +275,84 @@ namespace autopilot
     void Main::地上子通過執行(m 直前位置)
     {
         for (const ATS_BEACONDATA &地上子 : _通過済地上子) {
-            _状態.地上子通過(地上子, 直前位置);
-            _tasc.地上子通過(地上子, 直前位置, _状態);
-            _ato.地上子通過(地上子, 直前位置, _状態);
+            // 互換モード設定の地上子の次からは新しい互換モードの表を使う
+            現在の地上子振り分け().実行(地上子, 直前位置, _状態);
         }
         _通過済地上子.clear();
-        _通過済地上子.shrink_to_fit();
+    }
+
+    const 地上子振り分け &Main::現在の地上子振り分け() const
+    {
+        auto モード = static_cast<std::size_t>(_状態.互換モード());
+        // 知らない互換モードは無効と同じく扱う
+        return _地上子振り分け[
+            モード < _地上子振り分け.size() ? モード : 0];
+    }
+
+    namespace
+    {
+
+        constexpr char 状態識別子[8] = {'B', 'V', 'E', 'A', 'P', 'S', 'S', 0};
+        /// 状態の形式を変えたら増やす
+        constexpr std::uint32_t 状態形式版 = 2;
+
+    }
+
+    void Main::状態保存(std::vector<unsigned char> &出力先) const
+    {
+        出力先.clear();
+        状態書込 書込{出力先};
+        書込.値(状態識別子);
+        書込.値(状態形式版);
+
+        _状態.状態保存(書込);
+        _tasc.状態保存(書込);
+        _ato.状態保存(書込);
+        書込.値(_tasc有効);
+        書込.値(_ato有効);
+        書込.一覧(_通過済地上子);
+        書込.個数(_音声状態.size());
+        for (const auto &i : _音声状態) {
+            書込.値(i.first);
+            書込.値(i.second);
+        }
+        書込.値(_パネル変化数);
+        書込.値(_音声変化数);
+    }
+
+    void Main::状態復元(const std::vector<unsigned char> &保存状態)
+    {
+        状態読込 読込{保存状態.data(), 保存状態.size()};
+        char 識別子[sizeof 状態識別子];
+        std::uint32_t 形式版;
+        読込.値(識別子);
+        読込.値(形式版);
+        if (std::memcmp(識別子, 状態識別子, sizeof 識別子) != 0 ||
+            形式版 != 状態形式版)
+        {
+            throw std::runtime_error("unsupported autopilot snapshot");
+        }
+
+        _状態.状態復元(読込);
+        _tasc.状態復元(読込);
+        _ato.状態復元(読込);
+        読込.値(_tasc有効);
+        読込.値(_ato有効);
+        読込.一覧(_通過済地上子);
+        std::size_t 音声数 = 読込.個数(sizeof(音声) + sizeof(音声出力));
+        _音声状態.clear();
+        for (std::size_t i = 0; i < 音声数; i++) {
+            音声 種類;
+            音声出力 出力;
+            読込.値(種類);
+            読込.値(出力);
+            _音声状態.emplace(種類, 出力);
+        }
+        読込.値(_パネル変化数);
+        読込.値(_音声変化数);
+        if (読込.残り() != 0) {
+            throw std::runtime_error("trailing data in autopilot snapshot");
+        }
     }
 
 }
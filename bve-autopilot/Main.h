@@ -18,11 +18,15 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
+#include <array>
+#include <cstddef>
 #include <vector>
 #include <unordered_map>
 #include "ato.h"
 #include "tasc.h"
 #include "共通状態.h"
+#include "停止予測.h"
+#include "地上子振り分け.h"
 #include "音声出力.h"
 
 namespace autopilot
@@ -33,16 +37,30 @@ namespace autopilot
     public:
         Main();
         ~Main();
+        // 地上子振り分けが各部品の場所を覚えているのでコピーしない
+        Main(const Main &) = delete;
+        Main &operator=(const Main &) = delete;
 
         const 共通状態 & 状態() const { return _状態; }
         const tasc & tasc状態() const { return _tasc; }
         const ato & ato状態() const { return _ato; }
+        /// パネルに割り当てていなければ予測しない
+        const 停止予測 & tasc停止予測() const { return _停止予測; }
         bool tasc有効() const { return _tasc有効; }
         bool ato有効() const { return _ato有効; }
+        /// 以下の三つはパネルに割り当てていなければ求めない
         mps 現在制限速度() const;
         mps 現在常用パターン速度() const;
         mps 現在orp照査速度() const;
         bool 力行抑止中() const { return _ato.力行抑止中(); }
+        /// 設定ファイルで割り当てたパネルに出力する (経過の最後にも行う)。
+        /// 値が変わって書き換えた出力先の数を返す。
+        std::size_t パネル出力(int *出力値) const {
+            return _状態.設定().パネル出力割当().出力(*this, 出力値);
+        }
+        /// 直前の経過で値が変わって書き換えたパネル・音声の出力先の数
+        std::size_t パネル変化数() const { return _パネル変化数; }
+        std::size_t 音声変化数() const { return _音声変化数; }
 
         void 車両仕様設定(const ATS_VEHICLESPEC & 車両仕様)
         {
@@ -53,6 +71,7 @@ namespace autopilot
             _状態.設定ファイル読込(設定ファイル名);
             _tasc有効 = _状態.設定().tasc初期起動();
             _ato有効 = _状態.設定().ato初期起動();
+            _停止予測.準備(_状態);
         }
 
         void 逆転器操作(int ノッチ);
@@ -70,15 +89,28 @@ namespace autopilot
 
         ATS_HANDLES 経過(const ATS_VEHICLESTATE & 状態, int * 出力値, int * 音声状態);
 
+        /// 設定と車両仕様以外の全ての状態を 出力先 に書き出す (元の内容は
+        /// 消す)。同じビルドのプログラムの 状態復元 でのみ読める。
+        void 状態保存(std::vector<unsigned char> &出力先) const;
+        /// 状態保存 で書き出した時点の状態に戻す。設定ファイル読込 と
+        /// 車両仕様設定 は先に済ませておく。違う形式のデータや途中で
+        /// 終わっているデータなら std::runtime_error を投げる。
+        void 状態復元(const std::vector<unsigned char> &保存状態);
+
     private:
         共通状態 _状態;
         tasc _tasc;
         ato _ato;
+        停止予測 _停止予測;
         bool _tasc有効, _ato有効;
         std::vector<ATS_BEACONDATA> _通過済地上子;
+        // 互換モード型の値ごとに作っておく
+        std::array<地上子振り分け, 4> _地上子振り分け;
         std::unordered_map<音声, 音声出力> _音声状態;
+        std::size_t _パネル変化数 = 0, _音声変化数 = 0;
 
         void 地上子通過執行(m 直前位置);
+        const 地上子振り分け &現在の地上子振り分け() const;
     };
 
 }
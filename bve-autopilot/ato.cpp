@@ -23,7 +23,9 @@
 #include <cmath>
 #include <limits>
 #include "共通状態.h"
+#include "処理時間計測.h"
 #include "物理量.h"
+#include "状態保存.h"
 
 namespace autopilot
 {
@@ -87,6 +89,7 @@ namespace autopilot
         _信号.リセット();
         _orp.リセット();
         _急動作抑制.リセット();
+        _制限速度状況 = {};
     }
 
     void ato::発進(const 共通状態 &状態, 発進方式 方式)
@@ -111,51 +114,40 @@ namespace autopilot
     void ato::地上子通過(
         const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
     {
-        switch (地上子.Type)
-        {
+        switch (地上子.Type) {
         case 1006: // 制限速度設定
-            制限区間追加(
-                _制限速度1006, 地上子.Optional, {直前位置, 状態.現在位置()});
+            制限速度地上子<1006>(地上子, 直前位置, 状態);
             break;
         case 1007: // 制限速度設定
-            制限区間追加(
-                _制限速度1007, 地上子.Optional, {直前位置, 状態.現在位置()});
+            制限速度地上子<1007>(地上子, 直前位置, 状態);
             break;
         }
 
         if (状態.互換モード() == 互換モード型::swp2) {
             switch (地上子.Type) {
             case 6: // 制限速度設定
-                制限区間追加(
-                    _制限速度6, 地上子.Optional, {直前位置, 状態.現在位置()},
-                    10.0_kmph);
+                制限速度地上子<6>(地上子, 直前位置, 状態);
                 break;
             case 8: // 制限速度設定
-                制限区間追加(
-                    _制限速度8, 地上子.Optional, {直前位置, 状態.現在位置()},
-                    10.0_kmph);
+                制限速度地上子<8>(地上子, 直前位置, 状態);
                 break;
             case 9: // 制限速度設定
-                制限区間追加(
-                    _制限速度9, 地上子.Optional, {直前位置, 状態.現在位置()},
-                    10.0_kmph);
+                制限速度地上子<9>(地上子, 直前位置, 状態);
                 break;
             case 10: // 制限速度設定
-                制限区間追加(
-                    _制限速度10, 地上子.Optional, {直前位置, 状態.現在位置()},
-                    10.0_kmph);
+                制限速度地上子<10>(地上子, 直前位置, 状態);
                 break;
             case 16: // 制限速度解除
-                制限区間終了(_制限速度6, {直前位置, 状態.現在位置()});
+                制限解除地上子<6>(地上子, 直前位置, 状態);
                 break;
             case 18: // 制限速度解除
-                制限区間終了(_制限速度8, {直前位置, 状態.現在位置()});
+                制限解除地上子<8>(地上子, 直前位置, 状態);
                 break;
             case 19: // 制限速度解除
-                制限区間終了(_制限速度9, {直前位置, 状態.現在位置()});
+                制限解除地上子<9>(地上子, 直前位置, 状態);
                 break;
             case 20: // 制限速度解除
-                制限区間終了(_制限速度10, {直前位置, 状態.現在位置()});
+                制限解除地上子<10>(地上子, 直前位置, 状態);
                 break;
             }
         }
@@ -165,6 +157,97 @@ namespace autopilot
         _早着防止.地上子通過(地上子, 直前位置);
     }
 
+    void ato::地上子処理登録(地上子振り分け &振り分け, 互換モード型 モード)
+    {
+        互換モード別(モード, [&](auto 定数) {
+            互換モード別登録<decltype(定数)::value>(振り分け);
+        });
+    }
+
+    template<互換モード型 モード>
+    void ato::互換モード別登録(地上子振り分け &振り分け)
+    {
+        振り分け.登録<&ato::制限速度地上子<1006>>({1006}, *this);
+        振り分け.登録<&ato::制限速度地上子<1007>>({1007}, *this);
+        if constexpr (モード == 互換モード型::swp2) {
+            振り分け.登録<&ato::制限速度地上子<6>>({6}, *this);
+            振り分け.登録<&ato::制限速度地上子<8>>({8}, *this);
+            振り分け.登録<&ato::制限速度地上子<9>>({9}, *this);
+            振り分け.登録<&ato::制限速度地上子<10>>({10}, *this);
+            振り分け.登録<&ato::制限解除地上子<6>>({16}, *this);
+            振り分け.登録<&ato::制限解除地上子<8>>({18}, *this);
+            振り分け.登録<&ato::制限解除地上子<9>>({19}, *this);
+            振り分け.登録<&ato::制限解除地上子<10>>({20}, *this);
+        }
+
+        // ORP は信号順守の後に信号現示を受け取る
+        _信号.地上子処理登録(振り分け, モード);
+        if constexpr (モード == 互換モード型::メトロ総合) {
+            振り分け.登録<&ato::orp動作開始地上子>({12}, *this);
+            振り分け.登録<&ato::orp信号現示地上子>({31, 1012}, *this);
+            // メトロ総合以外の互換モードでは ORP は動かないので、
+            // メトロ総合の表にだけ置けば良い
+            振り分け.登録<&ato::orp互換モード変化>({1001}, *this);
+        }
+
+        _早着防止.地上子処理登録(振り分け);
+    }
+
+    template<int 種類>
+    制限グラフ &ato::種類別制限グラフ()
+    {
+        if constexpr (種類 == 1006) {
+            return _制限速度1006;
+        }
+        else if constexpr (種類 == 1007) {
+            return _制限速度1007;
+        }
+        else if constexpr (種類 == 6) {
+            return _制限速度6;
+        }
+        else if constexpr (種類 == 8) {
+            return _制限速度8;
+        }
+        else if constexpr (種類 == 9) {
+            return _制限速度9;
+        }
+        else {
+            static_assert(種類 == 10);
+            return _制限速度10;
+        }
+    }
+
+    template<int 種類>
+    void ato::制限速度地上子(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
+    {
+        if constexpr (種類 == 1006 || 種類 == 1007) {
+            制限区間追加(
+                種類別制限グラフ<種類>(), 地上子.Optional,
+                {直前位置, 状態.現在位置()});
+        }
+        else { // swp2 互換
+            制限区間追加(
+                種類別制限グラフ<種類>(), 地上子.Optional,
+                {直前位置, 状態.現在位置()}, 10.0_kmph);
+        }
+    }
+
+    template<int 設定種類>
+    void ato::制限解除地上子(
+        const ATS_BEACONDATA &, m 直前位置, const 共通状態 &状態)
+    {
+        制限区間終了(種類別制限グラフ<設定種類>(), {直前位置, 状態.現在位置()});
+    }
+
+    void ato::orp互換モード変化(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
+    {
+        // 振り分け表はメトロ総合のものが選ばれたままで、
+        // 新しい互換モードは 状態 に入っている
+        _orp.地上子通過(地上子, 直前位置, 状態, _信号);
+    }
+
     void ato::経過(const 共通状態 &状態)
     {
         m 最後尾 = 状態.現在位置() - 状態.列車長();
@@ -174,9 +257,18 @@ namespace autopilot
         _制限速度8.通過(最後尾);
         _制限速度9.通過(最後尾);
         _制限速度10.通過(最後尾);
-        _信号.経過(状態);
-        _orp.経過(状態);
-        _早着防止.経過(状態);
+        {
+            計測区間 計測{計測区分::信号順守};
+            _信号.経過(状態);
+        }
+        {
+            計測区間 計測{計測区分::orp};
+            _orp.経過(状態);
+        }
+        {
+            計測区間 計測{計測区分::早着防止};
+            _早着防止.経過(状態);
+        }
 
         if (_制御状態 == 制御状態::発進) {
             if (!状態.停車中() || !発進可能(状態)) {
@@ -193,15 +285,30 @@ namespace autopilot
             _出力ノッチ = 状態.転動防止自動ノッチ();
         }
         else {
-            _急動作抑制.経過(_信号.出力ノッチ(状態), 状態, _信号.is_atc());
+            自動制御指令 信号ノッチ;
+            {
+                計測区間 計測{計測区分::信号順守};
+                信号ノッチ = _信号.出力ノッチ(状態);
+            }
+            {
+                計測区間 計測{計測区分::急動作抑制};
+                _急動作抑制.経過(信号ノッチ, 状態, _信号.is_atc());
+            }
+
+            計測区間 計測{計測区分::制限グラフ};
+            _制限速度パターン.消去();
+            _制限速度1006.評価対象追加(_制限速度パターン, 状態, 1006);
+            _制限速度1007.評価対象追加(_制限速度パターン, 状態, 1007);
+            _制限速度6.評価対象追加(_制限速度パターン, 状態, 6);
+            _制限速度8.評価対象追加(_制限速度パターン, 状態, 8);
+            _制限速度9.評価対象追加(_制限速度パターン, 状態, 9);
+            _制限速度10.評価対象追加(_制限速度パターン, 状態, 10);
+            _制限速度評価結果 = _制限速度パターン.評価(
+                減速パターン::共通入力{状態});
+
             _出力ノッチ = std::min({
                 自動制御指令{状態.最大力行ノッチ()},
-                _制限速度1006.出力ノッチ(状態),
-                _制限速度1007.出力ノッチ(状態),
-                _制限速度6.出力ノッチ(状態),
-                _制限速度8.出力ノッチ(状態),
-                _制限速度9.出力ノッチ(状態),
-                _制限速度10.出力ノッチ(状態),
+                _制限速度評価結果.ノッチ,
                 _orp.出力ノッチ(),
                 _早着防止.出力ノッチ(),
                 _急動作抑制.出力ノッチ(),
@@ -209,28 +316,26 @@ namespace autopilot
         }
     }
 
-    mps ato::現在制限速度(const 共通状態 &状態) const
+    ato::制限速度状況 ato::制限速度状況計算(const 共通状態 &状態) const
     {
+        制限速度状況 結果;
         区間 列車範囲 = 状態.現在範囲();
-        mps 速度 = std::min({
-            _制限速度1006.制限速度(列車範囲),
-            _制限速度1007.制限速度(列車範囲),
-            _制限速度6.制限速度(列車範囲),
-            _制限速度8.制限速度(列車範囲),
-            _制限速度9.制限速度(列車範囲),
-            _制限速度10.制限速度(列車範囲),
-            _信号.現在制限速度(状態),
-            });
-
-        if (_orp.照査中() && _orp.照査速度() <= 速度) {
-            return mps::無限大();
-        }
-        return 速度;
-    }
+        auto 制限追加 = [&](mps 速度, パターン一括評価::出所型 出所) {
+            // 同じ速度なら先に調べたものを出所とする
+            if (速度 < 結果.制限速度) {
+                結果.制限速度 = 速度;
+                結果.出所 = 出所;
+            }
+        };
+        制限追加(_制限速度1006.制限速度(列車範囲), 1006);
+        制限追加(_制限速度1007.制限速度(列車範囲), 1007);
+        制限追加(_制限速度6.制限速度(列車範囲), 6);
+        制限追加(_制限速度8.制限速度(列車範囲), 8);
+        制限追加(_制限速度9.制限速度(列車範囲), 9);
+        制限追加(_制限速度10.制限速度(列車範囲), 10);
+        制限追加(_信号.現在制限速度(状態), 信号による制限);
 
-    mps ato::現在常用パターン速度(const 共通状態 &状態) const
-    {
-        mps 速度 = std::min({
+        結果.常用パターン速度 = std::min({
             _制限速度1006.現在常用パターン速度(状態),
             _制限速度1007.現在常用パターン速度(状態),
             _制限速度6.現在常用パターン速度(状態),
@@ -241,18 +346,53 @@ namespace autopilot
             });
 
         if (_orp.照査中()) {
-            速度 = std::min(速度, _orp.照査速度());
+            結果.orp照査速度 = _orp.照査速度();
+            if (結果.orp照査速度 <= 結果.制限速度) {
+                結果.制限速度 = mps::無限大();
+                結果.出所 = 制限なし;
+            }
+            結果.常用パターン速度 =
+                std::min(結果.常用パターン速度, 結果.orp照査速度);
         }
-        return 速度;
+        return 結果;
     }
 
-    mps ato::現在orp照査速度() const
+    void ato::状態保存(状態書込 &書込) const
     {
-        if (!_orp.照査中()) {
-            return mps::無限大();
+        for (const 制限グラフ *グラフ : {
+            &_制限速度1006, &_制限速度1007,
+            &_制限速度6, &_制限速度8, &_制限速度9, &_制限速度10})
+        {
+            グラフ->状態保存(書込);
         }
+        _信号.状態保存(書込);
+        _orp.状態保存(書込);
+        _早着防止.状態保存(書込);
+        書込.値(_制御状態);
+        書込.値(_出力ノッチ);
+        _急動作抑制.状態保存(書込);
+        書込.値(_制限速度評価結果);
+        書込.値(_制限速度状況);
+    }
 
-        return _orp.照査速度();
+    void ato::状態復元(状態読込 &読込)
+    {
+        for (制限グラフ *グラフ : {
+            &_制限速度1006, &_制限速度1007,
+            &_制限速度6, &_制限速度8, &_制限速度9, &_制限速度10})
+        {
+            グラフ->状態復元(読込);
+        }
+        _信号.状態復元(読込);
+        _orp.状態復元(読込);
+        _早着防止.状態復元(読込);
+        読込.値(_制御状態);
+        読込.値(_出力ノッチ);
+        _急動作抑制.状態復元(読込);
+        読込.値(_制限速度評価結果);
+        読込.値(_制限速度状況);
+        // 番号の指すパターンは次の経過で作り直すまで無い
+        _制限速度パターン.消去();
     }
 
 }
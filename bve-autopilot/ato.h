@@ -21,9 +21,11 @@
 #include <limits>
 #include <map>
 #include "orp.h"
+#include "パターン一括評価.h"
 #include "信号順守.h"
 #include "制御指令.h"
 #include "制限グラフ.h"
+#include "地上子振り分け.h"
 #include "区間.h"
 #include "急動作抑制.h"
 #include "早着防止.h"
@@ -33,6 +35,9 @@ namespace autopilot
 {
 
     class 共通状態;
+    class 状態書込;
+    class 状態読込;
+    enum class 互換モード型;
 
     class ato
     {
@@ -40,6 +45,22 @@ namespace autopilot
         using 信号インデックス = int;
         using 発進方式 = 信号順守::発進方式;
 
+        /// 制限速度状況::出所 の値 (それ以外は制限速度を設定した地上子の番号)
+        static constexpr パターン一括評価::出所型 制限なし = -1;
+        static constexpr パターン一括評価::出所型 信号による制限 = 0;
+
+        /// 制限速度状況更新 で求める、制限速度に関する値
+        struct 制限速度状況
+        {
+            /// ORP の照査速度以上の制限は無視し、無限大にする
+            mps 制限速度 = mps::無限大();
+            mps 常用パターン速度 = mps::無限大();
+            /// ORP が照査していない時は無限大
+            mps orp照査速度 = mps::無限大();
+            /// 制限速度 を決めたもの
+            パターン一括評価::出所型 出所 = 制限なし;
+        };
+
         ato();
         ~ato();
 
@@ -49,18 +70,38 @@ namespace autopilot
         void tasc目標停止位置変化(区間 位置のある範囲) {
             _信号.tasc目標停止位置変化(位置のある範囲);
         }
+        /// 全ての種類の地上子を受け取り、信号順守・ORP・早着防止にも渡す
         void 地上子通過(
             const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        /// 指定した互換モードで ato とその部品が処理する種類の地上子を
+        /// 登録する
+        void 地上子処理登録(地上子振り分け &振り分け, 互換モード型 モード);
         void 経過(const 共通状態 &状態);
+        /// 経過 の後で呼ぶ。常用パターン速度は全ての制限区間を調べるので
+        /// 値を使う時 (パネルに割り当てた時) だけ呼ぶ。
+        void 制限速度状況更新(const 共通状態 &状態) {
+            _制限速度状況 = 制限速度状況計算(状態);
+        }
 
-        mps 現在制限速度(const 共通状態 &状態) const;
-        mps 現在常用パターン速度(const 共通状態 &状態) const;
-        mps 現在orp照査速度() const;
+        /// 直前の 制限速度状況更新 の時点の値
+        const 制限速度状況 &現在制限速度状況() const { return _制限速度状況; }
         bool 力行抑止中() const {
             return _早着防止.出力ノッチ() <= 力行ノッチ{1};
         }
 
         自動制御指令 出力ノッチ() const { return _出力ノッチ; }
+        /// 直前の経過で制限速度による出力ノッチを決めたパターン。
+        /// 出所は制限速度を設定した地上子の番号。
+        const パターン一括評価::結果 &制限速度評価結果() const {
+            return _制限速度評価結果;
+        }
+        const パターン一括評価 &制限速度パターン() const {
+            return _制限速度パターン;
+        }
+
+        /// 制限速度パターン は毎回の経過で作り直すので保存しない
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
 
     private:
         enum class 制御状態 { 停止, 発進, 走行, };
@@ -73,6 +114,33 @@ namespace autopilot
         制御状態 _制御状態 = 制御状態::走行;
         自動制御指令 _出力ノッチ;
         急動作抑制 _急動作抑制;
+        // 毎フレーム作り直すが、メモリは使い回す
+        パターン一括評価 _制限速度パターン;
+        パターン一括評価::結果 _制限速度評価結果 = {};
+        制限速度状況 _制限速度状況;
+
+        制限速度状況 制限速度状況計算(const 共通状態 &状態) const;
+        // 地上子の種類ごとの処理。互換モードは呼ぶ側で確かめる
+        template<int 種類>
+        制限グラフ &種類別制限グラフ();
+        template<int 種類>
+        void 制限速度地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        template<int 設定種類>
+        void 制限解除地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        void orp動作開始地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態) {
+            _orp.動作開始地上子(地上子, 直前位置, 状態, _信号);
+        }
+        void orp信号現示地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態) {
+            _orp.信号現示地上子(地上子, 直前位置, 状態, _信号);
+        }
+        void orp互換モード変化(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        template<互換モード型 モード>
+        void 互換モード別登録(地上子振り分け &振り分け);
     };
 
 }
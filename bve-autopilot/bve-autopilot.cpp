@@ -19,10 +19,14 @@
 
 #include "stdafx.h"
 #include <filesystem>
+#include <fstream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include "Main.h"
+#include "処理時間計測.h"
+#include "呼出記録.h"
 
 namespace {
 
@@ -32,6 +36,9 @@ namespace {
 
     std::filesystem::path dll_file_name;
 
+    std::ofstream trace_file;
+    std::optional<autopilot::呼出記録書込> trace_writer;
+
     std::filesystem::path get_module_file_name(HMODULE hModule)
     {
         std::wstring name;
@@ -62,6 +69,37 @@ namespace {
         return name;
     }
 
+    /// 設定ファイルの [debug] セクションで指定されたファイル名を返す。
+    /// trace があれば呼出しを記録し、profile があれば Dispose 時に処理時間の
+    /// 計測結果を書き出す。
+    std::filesystem::path debug_file_name(LPCWSTR key)
+    {
+        constexpr std::size_t buffer_size = 256;
+        WCHAR buffer[buffer_size];
+        DWORD size = GetPrivateProfileStringW(
+            L"debug", key, L"", buffer, buffer_size,
+            ini_file_name().c_str());
+        if (size <= 0 || buffer_size - 1 <= size) {
+            return {};
+        }
+        return dll_file_name.parent_path() / buffer;
+    }
+
+    void record(const autopilot::呼出 &call)
+    {
+        if (trace_writer) {
+            trace_writer->書込(call);
+        }
+    }
+
+    void record(autopilot::呼出種別 type, int argument = 0)
+    {
+        autopilot::呼出 call;
+        call.種別 = type;
+        call.引数 = argument;
+        record(call);
+    }
+
 }
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD  ul_reason_for_call, LPVOID)
@@ -86,14 +124,40 @@ ATS_API int WINAPI GetPluginVersion() {
 ATS_API void WINAPI Load() {
     dll_file_name = get_module_file_name(dll_module_handle);
     main = std::make_unique<autopilot::Main>();
+
+    std::filesystem::path trace_name = debug_file_name(L"trace");
+    if (!trace_name.empty()) {
+        trace_file.open(trace_name, std::ios::binary | std::ios::trunc);
+        if (trace_file) {
+            trace_writer.emplace(trace_file);
+        }
+    }
+    record(autopilot::呼出種別::Load);
 }
 
 ATS_API void WINAPI Dispose() {
+    record(autopilot::呼出種別::Dispose);
+    trace_writer.reset();
+    trace_file.close();
+
+    if (autopilot::処理時間計測::有効) {
+        std::filesystem::path profile_name = debug_file_name(L"profile");
+        if (!profile_name.empty()) {
+            std::ofstream profile_file{profile_name, std::ios::trunc};
+            autopilot::処理時間計測::記録.書出(profile_file);
+        }
+    }
+    autopilot::処理時間計測::記録.リセット();
+
     main = nullptr;
     dll_file_name.clear();
 }
 
 ATS_API void WINAPI SetVehicleSpec(ATS_VEHICLESPEC spec) {
+    autopilot::呼出 call;
+    call.種別 = autopilot::呼出種別::SetVehicleSpec;
+    call.車両仕様 = spec;
+    record(call);
     if (main != nullptr) {
         main->設定ファイル読込(ini_file_name().c_str());
         main->車両仕様設定(spec);
@@ -101,6 +165,7 @@ ATS_API void WINAPI SetVehicleSpec(ATS_VEHICLESPEC spec) {
 }
 
 ATS_API void WINAPI Initialize(int brake) {
+    record(autopilot::呼出種別::Initialize, brake);
     if (main != nullptr) {
         main->リセット(brake);
     }
@@ -108,6 +173,10 @@ ATS_API void WINAPI Initialize(int brake) {
 
 ATS_API ATS_HANDLES WINAPI Elapse(
     ATS_VEHICLESTATE state, int *panelValues, int *soundStates) {
+    autopilot::呼出 call;
+    call.種別 = autopilot::呼出種別::Elapse;
+    call.車両状態 = state;
+    record(call);
     if (main != nullptr) {
         return main->経過(state, panelValues, soundStates);
     }
@@ -115,60 +184,73 @@ ATS_API ATS_HANDLES WINAPI Elapse(
 }
 
 ATS_API void WINAPI SetPower(int notch) {
+    record(autopilot::呼出種別::SetPower, notch);
     if (main != nullptr) {
         main->力行操作(notch);
     }
 }
 
 ATS_API void WINAPI SetBrake(int notch) {
+    record(autopilot::呼出種別::SetBrake, notch);
     if (main != nullptr) {
         main->制動操作(notch);
     }
 }
 
 ATS_API void WINAPI SetReverser(int notch) {
+    record(autopilot::呼出種別::SetReverser, notch);
     if (main != nullptr) {
         main->逆転器操作(notch);
     }
 }
 
 ATS_API void WINAPI KeyDown(int key) {
+    record(autopilot::呼出種別::KeyDown, key);
     if (main != nullptr) {
         main->キー押し(key);
     }
 }
 
 ATS_API void WINAPI KeyUp(int key) {
+    record(autopilot::呼出種別::KeyUp, key);
     if (main != nullptr) {
         main->キー放し(key);
     }
 }
 
 ATS_API void WINAPI HornBlow(int type) {
+    record(autopilot::呼出種別::HornBlow, type);
     if (main != nullptr) {
         main->警笛操作(type);
     }
 }
 
 ATS_API void WINAPI DoorOpen() {
+    record(autopilot::呼出種別::DoorOpen);
     if (main != nullptr) {
         main->戸開();
     }
 }
 
 ATS_API void WINAPI DoorClose() {
+    record(autopilot::呼出種別::DoorClose);
     if (main != nullptr) {
         main->戸閉();
     }
 }
 
 ATS_API void WINAPI SetSignal(int aspect) {
+    record(autopilot::呼出種別::SetSignal, aspect);
     if (main != nullptr) {
         main->信号現示変化(aspect);
     }
 }
 
 ATS_API void WINAPI SetBeaconData(ATS_BEACONDATA data) {
+    autopilot::呼出 call;
+    call.種別 = autopilot::呼出種別::SetBeaconData;
+    call.地上子 = data;
+    record(call);
     if (main != nullptr) {
         main->地上子通過(data);
     }
@@ -26,6 +26,7 @@
 #include "共通状態.h"
 #include "物理量.h"
 #include "走行モデル.h"
+#include "状態保存.h"
 
 namespace autopilot
 {
@@ -101,27 +102,38 @@ namespace autopilot
         }
 
         switch (地上子.Type) {
-        case 12: { // ORP 動作開始 (メトロ総合プラグイン互換)
-            mps 初速度 = 信号.現在制限速度(状態);
-            m 残距離 = 地上子.Optional <= 48 ? 48.0_m : 79.0_m;
-            設定(初速度, 直前位置, 直前位置 + 残距離);
+        case 12: // ORP 動作開始 (メトロ総合プラグイン互換)
+            動作開始地上子(地上子, 直前位置, 状態, 信号);
             break;
-        }
         case 31: // 信号現示受信 (メトロ総合プラグイン互換)
         case 1012: // 信号現示受信
-            if (地上子.Signal == orp信号インデックス &&
-                地上子.Distance > 0)
-            {
-                mps 初速度 = 信号.現在制限速度(状態);
-                m 開始位置 = 直前位置 + static_cast<m>(地上子.Distance);
-                m orp距離 =
-                    初速度 <= static_cast<mps>(30.0_kmph) ? 48.0_m : 79.0_m;
-                設定(初速度, 開始位置, 開始位置 + orp距離);
-            }
+            信号現示地上子(地上子, 直前位置, 状態, 信号);
             break;
         }
     }
 
+    void orp::動作開始地上子(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態,
+        const 信号順守 &信号)
+    {
+        mps 初速度 = 信号.現在制限速度(状態);
+        m 残距離 = 地上子.Optional <= 48 ? 48.0_m : 79.0_m;
+        設定(初速度, 直前位置, 直前位置 + 残距離);
+    }
+
+    void orp::信号現示地上子(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態,
+        const 信号順守 &信号)
+    {
+        if (地上子.Signal == orp信号インデックス && 地上子.Distance > 0) {
+            mps 初速度 = 信号.現在制限速度(状態);
+            m 開始位置 = 直前位置 + static_cast<m>(地上子.Distance);
+            m orp距離 =
+                初速度 <= static_cast<mps>(30.0_kmph) ? 48.0_m : 79.0_m;
+            設定(初速度, 開始位置, 開始位置 + orp距離);
+        }
+    }
+
     void orp::経過(const 共通状態 &状態)
     {
         if (制御中() && 状態.現在速度() < 最終目標速度) {
@@ -143,4 +155,22 @@ namespace autopilot
         return _信号指示 == orp信号インデックス && 制御中();
     }
 
+    void orp::状態保存(状態書込 &書込) const
+    {
+        書込.値(_信号指示);
+        書込.値(_照査パターン);
+        書込.値(_運転パターン);
+        書込.値(_出力ノッチ);
+        書込.値(_照査速度);
+    }
+
+    void orp::状態復元(状態読込 &読込)
+    {
+        読込.値(_信号指示);
+        読込.値(_照査パターン);
+        読込.値(_運転パターン);
+        読込.値(_出力ノッチ);
+        読込.値(_照査速度);
+    }
+
 }
@@ -27,6 +27,8 @@ namespace autopilot
 
     class 共通状態;
     class 信号順守;
+    class 状態書込;
+    class 状態読込;
 
     class orp
     {
@@ -43,6 +45,13 @@ namespace autopilot
         void 地上子通過(
             const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態,
             const 信号順守 &信号);
+        // 地上子の種類ごとの処理。互換モードは呼ぶ側で確かめる
+        void 動作開始地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態,
+            const 信号順守 &信号);
+        void 信号現示地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態,
+            const 信号順守 &信号);
 
         void 経過(const 共通状態 &状態);
 
@@ -53,6 +62,9 @@ namespace autopilot
 
         mps 照査速度() const { return _照査速度; }
 
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+
     private:
         信号インデックス _信号指示;
         減速パターン _照査パターン, _運転パターン;
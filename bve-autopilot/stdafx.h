@@ -21,6 +21,8 @@
 
 #pragma once
 
+#ifdef _WIN32
+
 #include "targetver.h"
 
 #define WIN32_LEAN_AND_MEAN             // Windows ヘッダーからほとんど使用されていない部分を除外する
@@ -28,5 +30,12 @@
 // Windows ヘッダー ファイル
 #include <windows.h>
 
+#else
+
+// Windows 以外ではコア部分だけをビルドする (リプレイ用)
+#include "winapi_compat.h"
+
+#endif
+
 #define ATS_EXPORTS
 #include "atsplugin.h"
@@ -27,6 +27,7 @@
 #include "減速パターン.h"
 #include "物理量.h"
 #include "走行モデル.h"
+#include "状態保存.h"
 
 namespace autopilot {
 
@@ -88,40 +89,85 @@ namespace autopilot {
     void tasc::地上子通過(
         const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
     {
-        switch (地上子.Type) {
-        case 255: // TASC 目標停止位置設定
-            停止位置を追加(static_cast<m>(地上子.Optional), 状態);
-            break;
-        case 1031: // TASC 停止位置許容誤差設定
-            最大許容誤差を設定(static_cast<cm>(地上子.Optional));
-            break;
-        }
-
-        if (!状態.戸閉()) {
-            return; // 「停車場へ移動」時は無視する
-        }
         switch (地上子.Type)
         {
         case 17: // TASC 目標停止位置設定 (メトロ総合プラグイン互換)
             if (状態.互換モード() == 互換モード型::メトロ総合) {
-                次駅停止位置を設定(11.0_m, 直前位置, 状態);
+                次駅停止位置地上子<17>(地上子, 直前位置, 状態);
             }
             break;
         case 30: // TASC 目標停止位置設定
             if (状態.互換モード() == 互換モード型::汎用ats) {
-                次駅停止位置を設定(
-                    static_cast<m>(地上子.Optional / 1000), 直前位置, 状態);
+                次駅停止位置地上子<30>(地上子, 直前位置, 状態);
             }
             break;
         case 32: // TASC 目標停止位置設定 (メトロ総合プラグイン互換)
             if (状態.互換モード() == 互換モード型::メトロ総合) {
-                次駅停止位置を設定(500.0_m, 直前位置, 状態);
+                次駅停止位置地上子<32>(地上子, 直前位置, 状態);
             }
             break;
+        case 255: // TASC 目標停止位置設定
+            停止位置地上子(地上子, 直前位置, 状態);
+            break;
         case 1030: // TASC 目標停止位置設定
+            次駅停止位置地上子<1030>(地上子, 直前位置, 状態);
+            break;
+        case 1031: // TASC 停止位置許容誤差設定
+            許容誤差地上子(地上子, 直前位置, 状態);
+            break;
+        }
+    }
+
+    void tasc::地上子処理登録(地上子振り分け &振り分け, 互換モード型 モード)
+    {
+        互換モード別(モード, [&](auto 定数) {
+            互換モード別登録<decltype(定数)::value>(振り分け);
+        });
+    }
+
+    template<互換モード型 モード>
+    void tasc::互換モード別登録(地上子振り分け &振り分け)
+    {
+        振り分け.登録<&tasc::停止位置地上子>({255}, *this);
+        振り分け.登録<&tasc::次駅停止位置地上子<1030>>({1030}, *this);
+        振り分け.登録<&tasc::許容誤差地上子>({1031}, *this);
+        if constexpr (モード == 互換モード型::汎用ats) {
+            振り分け.登録<&tasc::次駅停止位置地上子<30>>({30}, *this);
+        }
+        if constexpr (モード == 互換モード型::メトロ総合) {
+            振り分け.登録<&tasc::次駅停止位置地上子<17>>({17}, *this);
+            振り分け.登録<&tasc::次駅停止位置地上子<32>>({32}, *this);
+        }
+    }
+
+    void tasc::停止位置地上子(
+        const ATS_BEACONDATA &地上子, m, const 共通状態 &状態)
+    {
+        停止位置を追加(static_cast<m>(地上子.Optional), 状態);
+    }
+
+    void tasc::許容誤差地上子(
+        const ATS_BEACONDATA &地上子, m, const 共通状態 &)
+    {
+        最大許容誤差を設定(static_cast<cm>(地上子.Optional));
+    }
+
+    template<int 種類>
+    void tasc::次駅停止位置地上子(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
+    {
+        if (!状態.戸閉()) {
+            return; // 「停車場へ移動」時は無視する
+        }
+        if constexpr (種類 == 17) { // メトロ総合プラグイン互換
+            次駅停止位置を設定(11.0_m, 直前位置, 状態);
+        }
+        else if constexpr (種類 == 32) { // メトロ総合プラグイン互換
+            次駅停止位置を設定(500.0_m, 直前位置, 状態);
+        }
+        else {
             次駅停止位置を設定(
                 static_cast<m>(地上子.Optional / 1000), 直前位置, 状態);
-            break;
         }
     }
 
@@ -256,4 +302,48 @@ namespace autopilot {
         return 減速度;
     }
 
+    void tasc::状態保存(状態書込 &書込) const
+    {
+        書込.個数(_停止位置一覧.size());
+        for (m 停止位置 : _停止位置一覧) {
+            書込.値(停止位置);
+        }
+        書込.値(_次駅停止位置のある範囲.get());
+        書込.値(_調整した次駅停止位置);
+        書込.値(_最大許容誤差);
+        書込.値(_目標減速度);
+        書込.値(_緩解);
+        書込.値(_出力ノッチ);
+    }
+
+    void tasc::状態復元(状態読込 &読込)
+    {
+        std::size_t 個数 = 読込.個数(sizeof(m));
+        _停止位置一覧.clear();
+        for (std::size_t i = 0; i < 個数; i++) {
+            m 停止位置;
+            読込.値(停止位置);
+            _停止位置一覧.insert(_停止位置一覧.end(), 停止位置);
+        }
+        区間 次駅停止位置のある範囲;
+        読込.値(次駅停止位置のある範囲);
+        _次駅停止位置のある範囲.set(次駅停止位置のある範囲);
+        読込.値(_調整した次駅停止位置);
+        読込.値(_最大許容誤差);
+        読込.値(_目標減速度);
+        読込.値(_緩解);
+        読込.値(_出力ノッチ);
+    }
+
+    void tasc::制御状態を写す(const tasc &元)
+    {
+        // 複製は監視されていないので set で知らせる先はない
+        _次駅停止位置のある範囲.set(元._次駅停止位置のある範囲.get());
+        _調整した次駅停止位置 = 元._調整した次駅停止位置;
+        _最大許容誤差 = 元._最大許容誤差;
+        _目標減速度 = 元._目標減速度;
+        _緩解 = 元._緩解;
+        _出力ノッチ = 元._出力ノッチ;
+    }
+
 }
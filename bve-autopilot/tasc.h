@@ -29,6 +29,9 @@
 
 namespace autopilot {
 
+    class 状態書込;
+    class 状態読込;
+
     class tasc
     {
     public:
@@ -40,6 +43,8 @@ namespace autopilot {
         void 戸閉(const 共通状態 &状態);
         void 地上子通過(
             const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        /// 指定した互換モードで 地上子通過 が処理する種類の地上子を登録する
+        void 地上子処理登録(地上子振り分け &振り分け, 互換モード型 モード);
         void 経過(const 共通状態 & 状態);
 
         m 目標停止位置() const;
@@ -51,6 +56,13 @@ namespace autopilot {
             _次駅停止位置のある範囲.set_observer(std::move(observer));
         }
 
+        /// 復元した目標停止位置は監視しているところにも知らせる
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+        /// 経過 に使う状態を 元 と同じにする (停止予測の複製に使う)。
+        /// 停止位置の一覧は写さず、監視しているところにも知らせない。
+        void 制御状態を写す(const tasc &元);
+
     private:
         std::set<m> _停止位置一覧;
         live<区間> _次駅停止位置のある範囲;
@@ -64,6 +76,17 @@ namespace autopilot {
         void 次駅停止位置を設定(m 残距離, m 直前位置, const 共通状態 &状態);
         void 最大許容誤差を設定(m 最大許容誤差);
 
+        // 地上子の種類ごとの処理。互換モードは呼ぶ側で確かめる
+        void 停止位置地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        void 許容誤差地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        template<int 種類>
+        void 次駅停止位置地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        template<互換モード型 モード>
+        void 互換モード別登録(地上子振り分け &振り分け);
+
         mps2 出力減速度(m 停止位置, mps2 勾配影響, const 共通状態 &状態) const;
     };
 
@@ -0,0 +1,287 @@
+// winapi_compat.cpp : Windows 以外の環境でビルドするための Win32 API の代替です
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+    using entry = std::pair<std::wstring, std::wstring>;
+
+    std::wstring decode_utf8(const std::string &bytes, std::size_t i)
+    {
+        std::wstring text;
+        while (i < bytes.size()) {
+            auto c = static_cast<unsigned char>(bytes[i++]);
+            char32_t code;
+            int trailing;
+            if (c < 0x80) {
+                code = c, trailing = 0;
+            }
+            else if ((c & 0xE0) == 0xC0) {
+                code = c & 0x1F, trailing = 1;
+            }
+            else if ((c & 0xF0) == 0xE0) {
+                code = c & 0x0F, trailing = 2;
+            }
+            else if ((c & 0xF8) == 0xF0) {
+                code = c & 0x07, trailing = 3;
+            }
+            else {
+                text.push_back(L'�');
+                continue;
+            }
+            for (; trailing > 0 && i < bytes.size(); --trailing) {
+                auto t = static_cast<unsigned char>(bytes[i]);
+                if ((t & 0xC0) != 0x80) {
+                    break;
+                }
+                code = (code << 6) | (t & 0x3F);
+                ++i;
+            }
+            text.push_back(
+                trailing == 0 ? static_cast<wchar_t>(code) : L'�');
+        }
+        return text;
+    }
+
+    std::wstring decode_utf16le(const std::string &bytes, std::size_t i)
+    {
+        std::wstring text;
+        for (; i + 1 < bytes.size(); i += 2) {
+            char32_t unit = static_cast<unsigned char>(bytes[i]) |
+                static_cast<unsigned char>(bytes[i + 1]) << 8;
+            if (0xD800 <= unit && unit < 0xDC00 && i + 3 < bytes.size()) {
+                char32_t low = static_cast<unsigned char>(bytes[i + 2]) |
+                    static_cast<unsigned char>(bytes[i + 3]) << 8;
+                if (0xDC00 <= low && low < 0xE000) {
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                }
+            }
+            text.push_back(static_cast<wchar_t>(unit));
+        }
+        return text;
+    }
+
+    std::wstring read_file(LPCWSTR file_name)
+    {
+        std::ifstream file{
+            std::filesystem::path{file_name}, std::ios::binary};
+        std::string bytes{
+            std::istreambuf_iterator<char>{file},
+            std::istreambuf_iterator<char>{}};
+
+        if (bytes.compare(0, 2, "\xFF\xFE") == 0) {
+            return decode_utf16le(bytes, 2);
+        }
+        if (bytes.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            return decode_utf8(bytes, 3);
+        }
+        return decode_utf8(bytes, 0);
+    }
+
+    std::wstring_view trim(std::wstring_view s)
+    {
+        while (!s.empty() && std::iswspace(s.front())) {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && std::iswspace(s.back())) {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    bool equals_ignoring_case(std::wstring_view a, std::wstring_view b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+            [](wchar_t x, wchar_t y) {
+                return std::towlower(x) == std::towlower(y);
+            });
+    }
+
+    /// 空行と注釈を除いた各行を、前後の空白を除いてファイル内の順に渡す。
+    template<typename F>
+    void for_each_line(const std::wstring &text, F &&f)
+    {
+        std::size_t begin = 0;
+        while (begin < text.size()) {
+            std::size_t end = text.find(L'\n', begin);
+            if (end == std::wstring::npos) {
+                end = text.size();
+            }
+            auto line =
+                trim(std::wstring_view{text}.substr(begin, end - begin));
+            begin = end + 1;
+
+            if (line.empty() || line.front() == L';') {
+                continue;
+            }
+            f(line);
+        }
+    }
+
+    /// 行がセクションの見出し ([名前]) ならその名前を返す。
+    /// ] で閉じていない見出しは名前を持たない (セクションを変えない)
+    std::optional<std::wstring_view> section_name(std::wstring_view line)
+    {
+        if (line.front() != L'[') {
+            return std::nullopt;
+        }
+        auto close = line.find(L']');
+        if (close == std::wstring_view::npos) {
+            return std::nullopt;
+        }
+        return trim(line.substr(1, close - 1));
+    }
+
+    /// 全てのセクション名をファイル内の順に返す。
+    std::vector<std::wstring_view> section_names(const std::wstring &text)
+    {
+        std::vector<std::wstring_view> names;
+        for_each_line(text, [&](std::wstring_view line) {
+            if (auto name = section_name(line)) {
+                names.push_back(*name);
+            }
+        });
+        return names;
+    }
+
+    /// 指定したセクションのキーと値を全てファイル内の順に返す。
+    /// セクションが見つからなければ空の一覧を返す。
+    std::vector<entry> section_entries(
+        const std::wstring &text, std::wstring_view section)
+    {
+        std::vector<entry> entries;
+        bool in_section = false;
+        for_each_line(text, [&](std::wstring_view line) {
+            if (line.front() == L'[') {
+                if (auto name = section_name(line)) {
+                    in_section = equals_ignoring_case(*name, section);
+                }
+                return;
+            }
+            if (!in_section) {
+                return;
+            }
+
+            auto equal = line.find(L'=');
+            auto key = trim(line.substr(0, equal));
+            auto value = equal == std::wstring_view::npos ?
+                std::wstring_view{} : trim(line.substr(equal + 1));
+            if (value.size() >= 2 &&
+                (value.front() == L'"' || value.front() == L'\'') &&
+                value.back() == value.front())
+            {
+                value = value.substr(1, value.size() - 2);
+            }
+            entries.emplace_back(key, value);
+        });
+        return entries;
+    }
+
+    DWORD copy_string(std::wstring_view s, LPWSTR buffer, DWORD size)
+    {
+        if (size == 0) {
+            return 0;
+        }
+        auto n = std::min<std::size_t>(s.size(), size - 1);
+        std::copy_n(s.begin(), n, buffer);
+        buffer[n] = L'\0';
+        return static_cast<DWORD>(n);
+    }
+
+    /// 文字列の一覧を NUL 区切りで書き込み、最後に NUL をもう一つ付ける。
+    DWORD copy_list(
+        const std::vector<std::wstring_view> &list,
+        LPWSTR buffer, DWORD size)
+    {
+        if (size < 2) {
+            if (size == 1) {
+                buffer[0] = L'\0';
+            }
+            return 0;
+        }
+
+        DWORD used = 0;
+        for (auto s : list) {
+            if (used + s.size() + 2 > size) {
+                // 入りきらないものは切り詰める
+                auto n = size - used - 2;
+                std::copy_n(s.begin(), n, buffer + used);
+                buffer[size - 2] = buffer[size - 1] = L'\0';
+                return size - 2;
+            }
+            std::copy(s.begin(), s.end(), buffer + used);
+            used += static_cast<DWORD>(s.size());
+            buffer[used++] = L'\0';
+        }
+        buffer[used] = L'\0';
+        return used;
+    }
+
+}
+
+DWORD GetPrivateProfileStringW(
+    LPCWSTR lpAppName, LPCWSTR lpKeyName, LPCWSTR lpDefault,
+    LPWSTR lpReturnedString, DWORD nSize, LPCWSTR lpFileName)
+{
+    std::wstring text = read_file(lpFileName);
+
+    if (lpAppName == nullptr) {
+        // セクション名の一覧
+        return copy_list(section_names(text), lpReturnedString, nSize);
+    }
+
+    std::vector<entry> entries = section_entries(text, lpAppName);
+
+    if (lpKeyName == nullptr) {
+        // キーの一覧
+        std::vector<std::wstring_view> keys;
+        for (const entry &e : entries) {
+            keys.push_back(e.first);
+        }
+        return copy_list(keys, lpReturnedString, nSize);
+    }
+
+    auto i = std::find_if(entries.begin(), entries.end(),
+        [&](const entry &e) {
+            return equals_ignoring_case(e.first, lpKeyName);
+        });
+    if (i != entries.end()) {
+        return copy_string(i->second, lpReturnedString, nSize);
+    }
+    return copy_string(
+        trim(lpDefault != nullptr ? lpDefault : L""), lpReturnedString, nSize);
+}
+
+#endif
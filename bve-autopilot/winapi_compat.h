@@ -0,0 +1,44 @@
+// winapi_compat.h : Windows 以外の環境でビルドするための Win32 API の代替です
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+
+// プラグインのコア部分 (autopilot::Main 以下) が使用する最小限の型と関数
+// だけを定義する。DLL のエクスポート関数 (bve-autopilot.cpp) は Windows
+// 専用なのでここでは扱わない。
+
+#include <cstddef>
+#include <cstdint>
+
+#define __declspec(x)
+#define WINAPI
+
+using BOOL = int;
+using DWORD = std::uint32_t;
+using WCHAR = wchar_t;
+using LPWSTR = WCHAR *;
+using LPCWSTR = const WCHAR *;
+using PCWSTR = const WCHAR *;
+
+/// Win32 の GetPrivateProfileStringW と同じ動作をします。
+/// 設定ファイルは UTF-8 (BOM 付きでもよい) か BOM 付き UTF-16LE で
+/// 書かれているものとします。
+DWORD GetPrivateProfileStringW(
+    LPCWSTR lpAppName, LPCWSTR lpKeyName, LPCWSTR lpDefault,
+    LPWSTR lpReturnedString, DWORD nSize, LPCWSTR lpFileName);
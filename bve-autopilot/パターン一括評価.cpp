@@ -0,0 +1,97 @@
+// パターン一括評価.cpp : 一フレーム分の減速パターンをまとめて評価します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+#include "パターン一括評価.h"
+#include <limits>
+
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    namespace
+    {
+        constexpr 自動制御指令 上限なし =
+            力行ノッチ{std::numeric_limits<unsigned>::max()};
+    }
+
+    パターン一括評価::パターン一括評価() :
+        _上限{上限なし, 0, パターンなし}
+    {
+    }
+
+    パターン一括評価::~パターン一括評価() = default;
+
+    void パターン一括評価::消去()
+    {
+        _目標位置.clear();
+        _目標速度.clear();
+        _初期減速度.clear();
+        _最終減速度.clear();
+        _パターン.clear();
+        _出所.clear();
+        _上限 = 結果{上限なし, 0, パターンなし};
+    }
+
+    void パターン一括評価::追加(const 減速パターン &パターン, 出所型 出所)
+    {
+        _目標位置.push_back(パターン.目標位置);
+        _目標速度.push_back(パターン.目標速度);
+        _初期減速度.push_back(パターン.初期減速度);
+        _最終減速度.push_back(パターン.最終減速度);
+        _パターン.push_back(&パターン);
+        _出所.push_back(出所);
+    }
+
+    void パターン一括評価::上限追加(自動制御指令 ノッチ, 出所型 出所)
+    {
+        if (ノッチ < _上限.ノッチ) {
+            _上限 = 結果{ノッチ, 出所, パターンなし};
+        }
+    }
+
+    パターン一括評価::結果 パターン一括評価::評価(
+        const 減速パターン::共通入力 &入力)
+    {
+        // 現在位置での期待速度はまとめて計算しておく
+        std::size_t 個数 = パターン数();
+        _期待速度.resize(個数);
+        _期待減速度.resize(個数);
+        減速パターン::期待速度と期待減速度一括計算(個数,
+            _目標位置.data(), _目標速度.data(),
+            _初期減速度.data(), _最終減速度.data(),
+            入力.現在位置, _期待速度.data(), _期待減速度.data());
+
+        結果 最小 = 結果{上限なし, 0, パターンなし};
+        for (std::size_t i = 0; i < 個数; i++) {
+            自動制御指令 ノッチ = パターン(i).出力ノッチ(
+                入力, {_期待速度[i], _期待減速度[i]});
+            if (ノッチ < 最小.ノッチ) {
+                最小 = 結果{ノッチ, _出所[i], i};
+            }
+        }
+
+        if (_上限.ノッチ < 最小.ノッチ) {
+            最小 = _上限;
+        }
+        return 最小;
+    }
+
+}
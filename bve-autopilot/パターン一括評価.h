@@ -0,0 +1,86 @@
+// パターン一括評価.h : 一フレーム分の減速パターンをまとめて評価します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "制御指令.h"
+#include "減速パターン.h"
+#include "物理量.h"
+
+#pragma warning(push)
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    /// 同じ車両状態に対して評価する減速パターンを配列ごとに並べて持ち、
+    /// 出力ノッチの最小値とそれを決めたパターンを一度に求めます。
+    class パターン一括評価
+    {
+    public:
+        /// パターンを追加した側が付ける識別番号 (ato では地上子の番号)
+        using 出所型 = int;
+        static constexpr std::size_t パターンなし = static_cast<std::size_t>(-1);
+
+        struct 結果
+        {
+            自動制御指令 ノッチ;
+            出所型 出所;
+            // ノッチを決めたパターンの番号。上限で決まった時は パターンなし
+            std::size_t 番号;
+        };
+
+        パターン一括評価();
+        ~パターン一括評価();
+
+        /// 確保したメモリは次のフレームのために残す
+        void 消去();
+        /// パターンは 評価 が終わるまで同じ場所に残っていなければならない
+        void 追加(const 減速パターン &パターン, 出所型 出所);
+        /// パターンによらない出力ノッチの上限を追加する
+        void 上限追加(自動制御指令 ノッチ, 出所型 出所);
+
+        std::size_t パターン数() const { return _目標位置.size(); }
+        const 減速パターン &パターン(std::size_t 番号) const {
+            return *_パターン[番号];
+        }
+        出所型 出所(std::size_t 番号) const { return _出所[番号]; }
+
+        /// 同じノッチになるものが複数ある時は先に追加したパターンを優先し、
+        /// 上限はパターンより後に扱う。
+        結果 評価(const 減速パターン::共通入力 &入力);
+
+    private:
+        // 期待速度と期待減速度一括計算 に渡すため値ごとに並べる
+        std::vector<m> _目標位置;
+        std::vector<mps> _目標速度;
+        std::vector<mps2> _初期減速度, _最終減速度;
+        std::vector<const 減速パターン *> _パターン;
+        std::vector<出所型> _出所;
+        結果 _上限;
+
+        // 評価の途中結果
+        std::vector<mps> _期待速度;
+        std::vector<mps2> _期待減速度;
+    };
+
+}
+
+#pragma warning(pop)
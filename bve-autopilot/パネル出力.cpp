@@ -32,30 +32,16 @@ namespace autopilot
     namespace
     {
 
-        class tasc残距離桁
-        {
-        public:
-            static constexpr int 無効値 = 11;
-
-            tasc残距離桁(int 桁) : _桁{桁} { }
-            ~tasc残距離桁() = default;
-
-            int operator()(const Main &main) const;
-
-        private:
-            int _桁;
-        };
+        constexpr int tasc残距離桁無効値 = 11;
 
-        int tasc残距離桁::operator()(const Main &main) const
+        int tasc残距離桁出力(cm 残距離, int 桁)
         {
-            cm 残距離 =
-                main.tasc状態().目標停止位置() - main.状態().現在位置();
             double 値 = 残距離.value;
             if (!std::isfinite(値)) {
-                return 無効値;
+                return tasc残距離桁無効値;
             }
             int v = static_cast<int>(std::abs(値));
-            for (int i = 0; i < _桁; ++i) {
+            for (int i = 0; i < 桁; ++i) {
                 v /= 10;
             }
             if (v == 0) {
@@ -64,90 +50,105 @@ namespace autopilot
             return v % 10;
         }
 
-        const std::unordered_map<std::wstring, パネル出力対象> 対象名簿 = {
-            {L"brake", パネル出力対象([](const Main & main) {
+        /// 速度を倍率倍して出力する。無限大なら -20 km/h とする
+        int 速度出力(kmph 速度, double 倍率)
+        {
+            double 出力 = 速度.value * 倍率;
+            if (!std::isfinite(出力)) {
+                出力 = -20.0 * 倍率;
+            }
+            return static_cast<int>(std::round(出力));
+        }
+
+        int 対象の値(
+            パネル出力対象 対象, const Main &main, cm 残距離)
+        {
+            switch (対象.種別()) {
+            case パネル出力種別::なし:
+                break;
+            case パネル出力種別::制動ノッチ:
                 return main.状態().前回制動指令().value;
-            })},
-            {L"power", パネル出力対象([](const Main & main) {
+            case パネル出力種別::力行ノッチ:
                 return main.状態().前回力行ノッチ();
-            })},
-
-            {L"tascenabled", パネル出力対象([](const Main & main) {
+            case パネル出力種別::tasc有効:
                 return main.tasc有効();
-            })},
-            {L"tascmonitor", パネル出力対象([](const Main & main) {
+            case パネル出力種別::tasc制御中:
                 return main.tasc有効() && main.tasc状態().制御中();
-            })},
-            {L"tascbrake", パネル出力対象([](const Main & main) {
+            case パネル出力種別::tasc制動ノッチ:
                 if (!main.tasc有効()) {
                     return 0;
                 }
                 return static_cast<int>(
                     main.tasc状態().出力ノッチ().制動成分().value);
-            })},
-            {L"tascdistance", パネル出力対象([](const Main &main) {
-                cm 残距離 =
-                    main.tasc状態().目標停止位置() - main.状態().現在位置();
-                double 値 = 残距離.value;
-                if (!std::isfinite(値)) {
+            case パネル出力種別::tasc残距離:
+                if (!std::isfinite(残距離.value)) {
                     return 0;
                 }
-                return static_cast<int>(値);
-            })},
-            {L"tascdistancesign", パネル出力対象([](const Main &main) {
-                auto 残距離 =
-                    main.tasc状態().目標停止位置() - main.状態().現在位置();
-                double 値 = 残距離.value;
-                if (!std::isfinite(値)) {
+                return static_cast<int>(残距離.value);
+            case パネル出力種別::tasc残距離符号:
+                if (!std::isfinite(残距離.value)) {
                     return 0;
                 }
-                return 値 >= 0.0 ? 1 : 2;
-            })},
-            {L"tascdistancedm2", パネル出力対象(tasc残距離桁(0))},
-            {L"tascdistancedm1", パネル出力対象(tasc残距離桁(1))},
-            {L"tascdistanced0", パネル出力対象(tasc残距離桁(2))},
-            {L"tascdistanced1", パネル出力対象(tasc残距離桁(3))},
-            {L"tascdistanced2", パネル出力対象(tasc残距離桁(4))},
-            {L"tascdistanced3", パネル出力対象(tasc残距離桁(5))},
-            {L"tascdistanced4", パネル出力対象(tasc残距離桁(6))},
-            {L"tascdistanced5", パネル出力対象(tasc残距離桁(7))},
-            {L"atoenabled", パネル出力対象([](const Main & main) {
+                return 残距離.value >= 0.0 ? 1 : 2;
+            case パネル出力種別::tasc残距離桁:
+                return tasc残距離桁出力(残距離, 対象.桁());
+            case パネル出力種別::tasc予測停止誤差:
+                if (!main.tasc停止予測().停止する()) {
+                    return 0;
+                }
+                return static_cast<int>(std::round(
+                    static_cast<cm>(main.tasc停止予測().停止誤差()).value));
+            case パネル出力種別::tasc予測ノッチ変化数:
+                return main.tasc停止予測().ノッチ変化数();
+            case パネル出力種別::ato有効:
                 return main.ato有効();
-            })},
-            {L"powerthrottle", パネル出力対象([](const Main &main) {
+            case パネル出力種別::力行抑止中:
                 return main.ato有効() && main.力行抑止中();
-            })},
-            {L"speedlimit", パネル出力対象([](const Main & main) {
-                kmph 制限速度 = main.現在制限速度();
-                double 出力 = 制限速度.value;
-                if (!std::isfinite(出力)) {
-                    出力 = -20;
-                }
-                return static_cast<int>(std::round(出力));
-            })},
-            {L"speedpattern", パネル出力対象([](const Main & main) {
-                kmph 制限速度 = main.現在常用パターン速度();
-                double 出力 = 制限速度.value * 100;
-                if (!std::isfinite(出力)) {
-                    出力 = -20.0 * 100;
-                }
-                return static_cast<int>(std::round(出力));
-            })},
-            {L"orpspeedlimit", パネル出力対象([](const Main &main) {
-                kmph 制限速度 = main.現在orp照査速度();
-                double 出力 = 制限速度.value * 100;
-                if (!std::isfinite(出力)) {
-                    出力 = -20.0 * 100;
+            case パネル出力種別::制限速度:
+                return 速度出力(main.現在制限速度(), 1);
+            case パネル出力種別::常用パターン速度:
+                return 速度出力(main.現在常用パターン速度(), 100);
+            case パネル出力種別::orp照査速度:
+                return 速度出力(main.現在orp照査速度(), 100);
+            case パネル出力種別::互換モード:
+                return static_cast<int>(main.状態().互換モード());
+            case パネル出力種別::速度雑音:
+                // 求まっていなければ 0 とする
+                if (!std::isfinite(main.状態().速度雑音().value)) {
+                    return 0;
                 }
-                return static_cast<int>(std::round(出力));
-            })},
-            {L"compatmode", パネル出力対象([](const Main &main) {
-                互換モード型 モード = main.状態().互換モード();
-                return static_cast<int>(モード);
-            })},
-        };
+                return 速度出力(main.状態().速度雑音(), 100);
+            }
+            return 0;
+        }
 
-        const パネル出力対象 無対象{ [](const Main &) { return 0; } };
+        const std::unordered_map<std::wstring, パネル出力対象> 対象名簿 = {
+            {L"brake", パネル出力種別::制動ノッチ},
+            {L"power", パネル出力種別::力行ノッチ},
+
+            {L"tascenabled", パネル出力種別::tasc有効},
+            {L"tascmonitor", パネル出力種別::tasc制御中},
+            {L"tascbrake", パネル出力種別::tasc制動ノッチ},
+            {L"tascdistance", パネル出力種別::tasc残距離},
+            {L"tascdistancesign", パネル出力種別::tasc残距離符号},
+            {L"tascdistancedm2", {パネル出力種別::tasc残距離桁, 0}},
+            {L"tascdistancedm1", {パネル出力種別::tasc残距離桁, 1}},
+            {L"tascdistanced0", {パネル出力種別::tasc残距離桁, 2}},
+            {L"tascdistanced1", {パネル出力種別::tasc残距離桁, 3}},
+            {L"tascdistanced2", {パネル出力種別::tasc残距離桁, 4}},
+            {L"tascdistanced3", {パネル出力種別::tasc残距離桁, 5}},
+            {L"tascdistanced4", {パネル出力種別::tasc残距離桁, 6}},
+            {L"tascdistanced5", {パネル出力種別::tasc残距離桁, 7}},
+            {L"tascpredictederror", パネル出力種別::tasc予測停止誤差},
+            {L"tascpredictednotchchanges", パネル出力種別::tasc予測ノッチ変化数},
+            {L"atoenabled", パネル出力種別::ato有効},
+            {L"powerthrottle", パネル出力種別::力行抑止中},
+            {L"speedlimit", パネル出力種別::制限速度},
+            {L"speedpattern", パネル出力種別::常用パターン速度},
+            {L"orpspeedlimit", パネル出力種別::orp照査速度},
+            {L"compatmode", パネル出力種別::互換モード},
+            {L"accelerationnoise", パネル出力種別::速度雑音},
+        };
 
     }
 
@@ -155,9 +156,77 @@ namespace autopilot
     {
         auto i = 対象名簿.find(名前);
         if (i == 対象名簿.end()) {
-            return 無対象;
+            return {};
         }
         return i->second;
     }
 
+    void パネル出力表::割当(int 出力先, パネル出力対象 対象)
+    {
+        _割当.erase(std::remove_if(_割当.begin(), _割当.end(),
+            [出力先](const 割当項目 &項目) {
+                return 項目.出力先 == 出力先;
+            }), _割当.end());
+
+        auto i = std::upper_bound(_割当.begin(), _割当.end(), 対象,
+            [出力先](パネル出力対象 追加対象, const 割当項目 &項目) {
+                if (追加対象 != 項目.対象) {
+                    return 追加対象 < 項目.対象;
+                }
+                return 出力先 < 項目.出力先;
+            });
+        _割当.insert(i, {出力先, 対象});
+
+        _残距離使用 = std::any_of(_割当.begin(), _割当.end(),
+            [](const 割当項目 &項目) {
+                switch (項目.対象.種別()) {
+                case パネル出力種別::tasc残距離:
+                case パネル出力種別::tasc残距離符号:
+                case パネル出力種別::tasc残距離桁:
+                    return true;
+                default:
+                    return false;
+                }
+            });
+        _停止予測使用 = std::any_of(_割当.begin(), _割当.end(),
+            [](const 割当項目 &項目) {
+                return 項目.対象.種別() == パネル出力種別::tasc予測停止誤差 ||
+                    項目.対象.種別() == パネル出力種別::tasc予測ノッチ変化数;
+            });
+        _制限速度状況使用 = std::any_of(_割当.begin(), _割当.end(),
+            [](const 割当項目 &項目) {
+                switch (項目.対象.種別()) {
+                case パネル出力種別::制限速度:
+                case パネル出力種別::常用パターン速度:
+                case パネル出力種別::orp照査速度:
+                    return true;
+                default:
+                    return false;
+                }
+            });
+    }
+
+    std::size_t パネル出力表::出力(const Main &main, int *出力値) const
+    {
+        // 複数の対象で使う値は先に一度だけ求める
+        cm 残距離 = {};
+        if (_残距離使用) {
+            残距離 = main.tasc状態().目標停止位置() - main.状態().現在位置();
+        }
+
+        std::size_t 変化数 = 0;
+        for (auto i = _割当.begin(); i != _割当.end(); ) {
+            int 値 = 対象の値(i->対象, main, 残距離);
+            auto 対象 = i->対象;
+            for (; i != _割当.end() && i->対象 == 対象; ++i) {
+                int &出力 = 出力値[i->出力先];
+                if (出力 != 値) {
+                    出力 = 値;
+                    変化数++;
+                }
+            }
+        }
+        return 変化数;
+    }
+
 }
@@ -18,28 +18,95 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
-#include <functional>
+#include <cstddef>
 #include <string>
-#include <utility>
+#include <vector>
 
 namespace autopilot
 {
 
     class Main;
 
+    /// パネルに出力する値の種類
+    enum class パネル出力種別 : unsigned char
+    {
+        なし,
+        制動ノッチ,
+        力行ノッチ,
+        tasc有効,
+        tasc制御中,
+        tasc制動ノッチ,
+        tasc残距離,
+        tasc残距離符号,
+        tasc残距離桁,
+        tasc予測停止誤差,
+        tasc予測ノッチ変化数,
+        ato有効,
+        力行抑止中,
+        制限速度,
+        常用パターン速度,
+        orp照査速度,
+        互換モード,
+        速度雑音,
+    };
+
     class パネル出力対象 {
     public:
-        パネル出力対象(const std::function<int(const Main &)> & 出力) :
-            _出力(出力) { }
-        パネル出力対象(std::function<int(const Main &)> && 出力) :
-            _出力(std::move(出力)) { }
+        constexpr パネル出力対象() = default;
+        constexpr パネル出力対象(パネル出力種別 種別, int 桁 = 0) :
+            _種別{種別}, _桁{桁} { }
+
+        パネル出力種別 種別() const { return _種別; }
+        /// tasc残距離桁 で出力する桁 (0 が 1 cm の位)
+        int 桁() const { return _桁; }
 
-        int 出力(const Main & main) const { return _出力(main); }
+        bool operator==(const パネル出力対象 &o) const {
+            return _種別 == o._種別 && _桁 == o._桁;
+        }
+        bool operator!=(const パネル出力対象 &o) const {
+            return !(*this == o);
+        }
+        bool operator<(const パネル出力対象 &o) const {
+            return _種別 != o._種別 ? _種別 < o._種別 : _桁 < o._桁;
+        }
 
+        /// 名前が分からなければ常に 0 を出力する対象を返す
         static パネル出力対象 対象(const std::wstring & 名前);
 
     private:
-        std::function<int(const Main &)> _出力;
+        パネル出力種別 _種別 = パネル出力種別::なし;
+        int _桁 = 0;
+    };
+
+    /// 設定ファイルで割り当てたパネル出力を、対象ごとにまとめて並べたもの。
+    /// 設定を読み込んだ時に作り、毎フレームはこの表に従って出力する。
+    class パネル出力表 {
+    public:
+        /// 同じ出力先に割り当て済みなら置き換える
+        void 割当(int 出力先, パネル出力対象 対象);
+        std::size_t 出力数() const { return _割当.size(); }
+        /// TASC の停止予測を使う対象があるか (なければ予測しない)
+        bool 停止予測使用() const { return _停止予測使用; }
+        /// ATO の制限速度状況を使う対象があるか (なければ求めない)
+        bool 制限速度状況使用() const { return _制限速度状況使用; }
+
+        /// 対象ごとに値を一度だけ求め、出力値の今の内容と違う出力先だけを
+        /// 書き換える。書き換えた出力先の数を返す。
+        std::size_t 出力(const Main &main, int *出力値) const;
+
+    private:
+        struct 割当項目
+        {
+            int 出力先;
+            パネル出力対象 対象;
+        };
+
+        // 対象の順。同じ対象の中では出力先の昇順
+        std::vector<割当項目> _割当;
+        // TASC の残距離を使う対象があるか (なければ計算しない)
+        bool _残距離使用 = false;
+        bool _停止予測使用 = false;
+        bool _制限速度状況使用 = false;
     };
 
 }
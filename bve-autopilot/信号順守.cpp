@@ -26,6 +26,7 @@
 #include <utility>
 #include "共通状態.h"
 #include "区間.h"
+#include "状態保存.h"
 
 #pragma warning(disable:4819)
 
@@ -35,16 +36,75 @@ namespace autopilot
     namespace
     {
 
-        void 信号速度設定(
-            std::map<信号順守::信号インデックス, mps> &速度表, int 地上子値)
+        // リセットの度に作り直さないように一度だけ作っておく
+        constexpr 信号順守::信号速度表型 既定の信号速度表 = {
+            {0, 0.0_kmph},
+            {1, 25.0_kmph},
+            {2, 40.0_kmph},
+            {3, 65.0_kmph},
+            {4, 85.0_kmph},
+            {5, 160.0_kmph},
+            {9, 0.0_kmph},
+            {10, 0.0_kmph},
+            {11, 10.0_kmph},
+            {12, 10.0_kmph},
+            {13, 15.0_kmph},
+            {14, 20.0_kmph},
+            {15, 25.0_kmph},
+            {16, 30.0_kmph},
+            {17, 35.0_kmph},
+            {18, 40.0_kmph},
+            {19, 45.0_kmph},
+            {20, 50.0_kmph},
+            {21, 55.0_kmph},
+            {22, 60.0_kmph},
+            {23, 65.0_kmph},
+            {24, 70.0_kmph},
+            {25, 75.0_kmph},
+            {26, 80.0_kmph},
+            {27, 85.0_kmph},
+            {28, 90.0_kmph},
+            {29, 95.0_kmph},
+            {30, 100.0_kmph},
+            {31, 105.0_kmph},
+            {32, 110.0_kmph},
+            {33, 120.0_kmph},
+            {36, 0.0_kmph},
+            {39, 45.0_kmph},
+            {40, 40.0_kmph},
+            {41, 35.0_kmph},
+            {42, 30.0_kmph},
+            {43, 25.0_kmph},
+            {44, 20.0_kmph},
+            {45, 15.0_kmph},
+            {46, 10.0_kmph},
+            {47, 10.0_kmph},
+            {48, 01.0_kmph},
+            {50, 0.0_kmph},
+            {51, 25.0_kmph},
+            {52, 40.0_kmph},
+            {53, 65.0_kmph},
+            {54, 100.0_kmph},
+            {101, 0.0_kmph},
+            {102, 0.0_kmph},
+            {103, 15.0_kmph},
+            {104, 25.0_kmph},
+            {105, 45.0_kmph},
+            {106, 55.0_kmph},
+            {107, 65.0_kmph},
+            {108, 75.0_kmph},
+            {109, 90.0_kmph},
+            {110, 100.0_kmph},
+            {111, 110.0_kmph},
+            {112, 120.0_kmph},
+        };
+
+        void 信号速度設定(信号順守::信号速度表型 &速度表, int 地上子値)
         {
+            // 範囲外の信号インデックスは 設定 が無視する
             信号順守::信号インデックス 指示 = 地上子値 / 1000;
-            if (指示 < 0 || 256 <= 指示) {
-                return;
-            }
-
             mps 速度 = static_cast<kmph>(地上子値 % 1000);
-            速度表[指示] = 速度;
+            速度表.設定(指示, 速度);
         }
 
         自動制御指令 atc停止出力ノッチ(const 共通状態 &状態)
@@ -76,8 +136,8 @@ namespace autopilot
             }
         };
 
-        信号順守::閉塞型 &対応する閉塞(
-            区間 始点のある範囲, std::deque<信号順守::閉塞型> &閉塞一覧)
+        std::pmr::vector<信号順守::閉塞型>::iterator 対応する閉塞(
+            区間 始点のある範囲, std::pmr::vector<信号順守::閉塞型> &閉塞一覧)
         {
             // 始点のある範囲が重なる閉塞を全て求める
             auto [i, j] = std::equal_range(
@@ -106,11 +166,31 @@ namespace autopilot
             }
             }
 
-            return *i;
+            return i;
         }
 
     }
 
+    信号順守::閉塞型::閉塞型(const 閉塞型 &元, const allocator_type &割当) :
+        信号指示{元.信号指示},
+        信号速度{元.信号速度},
+        始点のある範囲{元.始点のある範囲},
+        信号インデックス一覧{元.信号インデックス一覧},
+        停止解放{元.停止解放},
+        停止信号前照査一覧{元.停止信号前照査一覧, 割当}
+    {
+    }
+
+    信号順守::閉塞型::閉塞型(閉塞型 &&元, const allocator_type &割当) :
+        信号指示{元.信号指示},
+        信号速度{元.信号速度},
+        始点のある範囲{元.始点のある範囲},
+        信号インデックス一覧{元.信号インデックス一覧},
+        停止解放{元.停止解放},
+        停止信号前照査一覧{std::move(元.停止信号前照査一覧), 割当}
+    {
+    }
+
     /// 先行列車がいる閉塞(のうち最も近いもの)を推定
     int 信号順守::閉塞型::先行列車位置() const
     {
@@ -183,17 +263,17 @@ namespace autopilot
     }
 
     void 信号順守::閉塞型::信号速度更新(
-        const std::map<信号インデックス, mps> &速度表)
+        const 信号速度表型 &速度表)
     {
-        auto i = 速度表.find(信号指示);
-        if (i != 速度表.end()) {
-            信号速度 = i->second;
+        mps 速度 = 速度表[信号指示];
+        if (速度 != 信号速度表型::不明) {
+            信号速度 = 速度;
         }
     }
 
     void 信号順守::閉塞型::信号指示設定(
         信号インデックス 指示,
-        const std::map<信号インデックス, mps> &速度表)
+        const 信号速度表型 &速度表)
     {
         信号指示 = 指示;
         停止解放 = false;
@@ -202,7 +282,7 @@ namespace autopilot
 
     void 信号順守::閉塞型::状態更新(
         const ATS_BEACONDATA &地上子,
-        const std::map<信号インデックス, mps> &速度表,
+        const 信号速度表型 &速度表,
         bool 信号インデックスを更新する)
     {
         if (信号インデックスを更新する && 地上子.Optional > 0) {
@@ -219,7 +299,7 @@ namespace autopilot
         停止信号前照査一覧[位置] = 速度;
     }
 
-    void 信号順守::閉塞型::統合(const 閉塞型 &統合元)
+    void 信号順守::閉塞型::統合(閉塞型 &&統合元)
     {
         // 現在閉塞の信号指示は常に信号現示変化で受け取った値を使用する。
         // よって信号速度もここでは更新しない。
@@ -227,11 +307,12 @@ namespace autopilot
         始点のある範囲 = 統合元.始点のある範囲;
         信号インデックス一覧 = 統合元.信号インデックス一覧;
         停止解放 = 統合元.停止解放;
-        停止信号前照査一覧 = 統合元.停止信号前照査一覧;
+        // 同じプールから取ったものなのでノードごと受け取れる
+        停止信号前照査一覧 = std::move(統合元.停止信号前照査一覧);
     }
 
     void 信号順守::閉塞型::先行列車位置から信号指示を推定(
-        int 閉塞数, const std::map<信号インデックス, mps> &速度表)
+        int 閉塞数, const 信号速度表型 &速度表)
     {
         int i = 信号インデックス一覧;
         if (i == 0) {
@@ -245,92 +326,35 @@ namespace autopilot
         }
 
         int 指示 = i % 10;
-        auto t = 速度表.find(指示);
-        if (t != 速度表.end()) {
-            auto 速度 = t->second;
-            if (速度 > 信号速度) {
-                信号指示 = 指示;
-                信号速度 = 速度;
-            }
+        mps 速度 = 速度表[指示];
+        if (速度 != 信号速度表型::不明 && 速度 > 信号速度) {
+            信号指示 = 指示;
+            信号速度 = 速度;
         }
     }
 
-    信号順守::信号順守() = default;
+    信号順守::信号順守() :
+        _現在閉塞{&_閉塞メモリ},
+        _前方閉塞一覧{&_閉塞メモリ}
+    {
+    }
+
     信号順守::~信号順守() = default;
 
     void 信号順守::リセット()
     {
-        _信号速度表 = {
-            {0, 0.0_kmph},
-            {1, 25.0_kmph},
-            {2, 40.0_kmph},
-            {3, 65.0_kmph},
-            {4, 85.0_kmph},
-            {5, 160.0_kmph},
-            {9, 0.0_kmph},
-            {10, 0.0_kmph},
-            {11, 10.0_kmph},
-            {12, 10.0_kmph},
-            {13, 15.0_kmph},
-            {14, 20.0_kmph},
-            {15, 25.0_kmph},
-            {16, 30.0_kmph},
-            {17, 35.0_kmph},
-            {18, 40.0_kmph},
-            {19, 45.0_kmph},
-            {20, 50.0_kmph},
-            {21, 55.0_kmph},
-            {22, 60.0_kmph},
-            {23, 65.0_kmph},
-            {24, 70.0_kmph},
-            {25, 75.0_kmph},
-            {26, 80.0_kmph},
-            {27, 85.0_kmph},
-            {28, 90.0_kmph},
-            {29, 95.0_kmph},
-            {30, 100.0_kmph},
-            {31, 105.0_kmph},
-            {32, 110.0_kmph},
-            {33, 120.0_kmph},
-            {36, 0.0_kmph},
-            {39, 45.0_kmph},
-            {40, 40.0_kmph},
-            {41, 35.0_kmph},
-            {42, 30.0_kmph},
-            {43, 25.0_kmph},
-            {44, 20.0_kmph},
-            {45, 15.0_kmph},
-            {46, 10.0_kmph},
-            {47, 10.0_kmph},
-            {48, 01.0_kmph},
-            {50, 0.0_kmph},
-            {51, 25.0_kmph},
-            {52, 40.0_kmph},
-            {53, 65.0_kmph},
-            {54, 100.0_kmph},
-            {101, 0.0_kmph},
-            {102, 0.0_kmph},
-            {103, 15.0_kmph},
-            {104, 25.0_kmph},
-            {105, 45.0_kmph},
-            {106, 55.0_kmph},
-            {107, 65.0_kmph},
-            {108, 75.0_kmph},
-            {109, 90.0_kmph},
-            {110, 100.0_kmph},
-            {111, 110.0_kmph},
-            {112, 120.0_kmph},
-        };
+        _信号速度表 = 既定の信号速度表;
 
-        if (_現在閉塞.信号指示 == 閉塞型::無指示) {
-            _現在閉塞 = 閉塞型{};
-        }
-        else {
+        // 閉塞メモリはそのまま残し、空いた分は次の閉塞で使う
+        閉塞型 現在閉塞{&_閉塞メモリ};
+        if (_現在閉塞.信号指示 != 閉塞型::無指示) {
             // リセット後に信号現示変化が来ないことがあるので
             // 現在閉塞の状態を維持する
-            _現在閉塞 = 閉塞型{
-                _現在閉塞.信号指示, _現在閉塞.信号速度, -m::無限大()};
+            現在閉塞.信号指示 = _現在閉塞.信号指示;
+            現在閉塞.信号速度 = _現在閉塞.信号速度;
+            現在閉塞.始点のある範囲 = 区間{-m::無限大(), -m::無限大()};
         }
+        _現在閉塞 = std::move(現在閉塞);
 
         _前方閉塞一覧.clear();
         信号グラフ再計算();
@@ -371,7 +395,15 @@ namespace autopilot
     void 信号順守::tasc目標停止位置変化(区間 位置のある範囲)
     {
         _tasc目標停止位置 = 位置のある範囲.始点;
-        信号グラフ再計算();
+
+        // TASC の停止位置は停止信号の閉塞の制限区間にしか影響しない
+        std::size_t 閉塞数 = _前方閉塞一覧.size() + 1;
+        for (std::size_t i = 0; i < 閉塞数; i++) {
+            if (番号の閉塞(i).信号速度 == 0.0_mps) {
+                信号グラフ再計算(i);
+                return;
+            }
+        }
     }
 
     void 信号順守::地上子通過(
@@ -381,31 +413,65 @@ namespace autopilot
         {
         case 3: // 信号現示受信 (各種 ATS-P プラグイン互換)
             if (状態.互換モード() == 互換モード型::swp2) {
-                信号現示受信(地上子, 直前位置, 状態, false);
+                信号現示地上子<false>(地上子, 直前位置, 状態);
             }
             break;
         case 31: // 信号現示受信 (メトロ総合プラグイン互換)
             if (状態.互換モード() == 互換モード型::メトロ総合) {
-                信号現示受信(地上子, 直前位置, 状態, false);
+                信号現示地上子<false>(地上子, 直前位置, 状態);
             }
             break;
         case 1016: // 停止信号前速度設定
-            if (閉塞型 *閉塞 = 信号現示受信(地上子, 直前位置, 状態, false)) {
-                閉塞->停止信号前照査設定(地上子, 直前位置);
-                信号グラフ再計算();
-            }
+            停止信号前速度地上子(地上子, 直前位置, 状態);
             break;
         case 1011: // 信号速度設定
-            信号速度設定(_信号速度表, 地上子.Optional);
-            信号速度更新();
-            信号グラフ再計算();
+            信号速度地上子(地上子, 直前位置, 状態);
             break;
         case 1012: // 信号現示受信
-            信号現示受信(地上子, 直前位置, 状態, true);
+            信号現示地上子<true>(地上子, 直前位置, 状態);
             break;
         }
     }
 
+    void 信号順守::地上子処理登録(地上子振り分け &振り分け, 互換モード型 モード)
+    {
+        互換モード別(モード, [&](auto 定数) {
+            互換モード別登録<decltype(定数)::value>(振り分け);
+        });
+    }
+
+    template<互換モード型 モード>
+    void 信号順守::互換モード別登録(地上子振り分け &振り分け)
+    {
+        if constexpr (モード == 互換モード型::swp2) {
+            振り分け.登録<&信号順守::信号現示地上子<false>>({3}, *this);
+        }
+        if constexpr (モード == 互換モード型::メトロ総合) {
+            振り分け.登録<&信号順守::信号現示地上子<false>>({31}, *this);
+        }
+        振り分け.登録<&信号順守::信号速度地上子>({1011}, *this);
+        振り分け.登録<&信号順守::信号現示地上子<true>>({1012}, *this);
+        振り分け.登録<&信号順守::停止信号前速度地上子>({1016}, *this);
+    }
+
+    void 信号順守::停止信号前速度地上子(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
+    {
+        auto i = 信号現示受信(地上子, 直前位置, 状態, false);
+        if (i != _前方閉塞一覧.end()) {
+            i->停止信号前照査設定(地上子, 直前位置);
+            信号グラフ再計算(std::distance(_前方閉塞一覧.begin(), i) + 1);
+        }
+    }
+
+    void 信号順守::信号速度地上子(
+        const ATS_BEACONDATA &地上子, m, const 共通状態 &)
+    {
+        信号速度設定(_信号速度表, 地上子.Optional);
+        信号速度更新();
+        信号グラフ再計算();
+    }
+
     void 信号順守::経過(const 共通状態 &状態)
     {
         // 通過済みの閉塞を現在閉塞に統合して消す
@@ -414,8 +480,8 @@ namespace autopilot
             if (!次閉塞.通過済(状態.現在位置())) {
                 break;
             }
-            _現在閉塞.統合(次閉塞);
-            _前方閉塞一覧.pop_front();
+            _現在閉塞.統合(std::move(次閉塞));
+            _前方閉塞一覧.erase(_前方閉塞一覧.begin());
             前方閉塞信号を推定();
             信号グラフ再計算();
         }
@@ -457,13 +523,13 @@ namespace autopilot
         }
     }
 
-    信号順守::閉塞型 *信号順守::信号現示受信(
+    std::pmr::vector<信号順守::閉塞型>::iterator 信号順守::信号現示受信(
         const ATS_BEACONDATA &地上子, m 直前位置,
         const 共通状態 &状態, bool 信号インデックスを更新する)
     {
         if (地上子.Distance == 0 && 状態.現在速度() != 0.0_mps) {
             // マップファイルのバージョンが古いとおかしなデータが来ることがある
-            return nullptr;
+            return _前方閉塞一覧.end();
         }
 
         if (直前位置 == 0.0_m) {
@@ -476,11 +542,10 @@ namespace autopilot
             安全マージン付き区間(直前位置, 状態.現在位置(), 残距離);
         assert(!受信した閉塞始点のある範囲.空である());
 
-        閉塞型 &閉塞 =
-            対応する閉塞(受信した閉塞始点のある範囲, _前方閉塞一覧);
-        閉塞.状態更新(地上子, _信号速度表, 信号インデックスを更新する);
-        信号グラフ再計算();
-        return &閉塞;
+        auto i = 対応する閉塞(受信した閉塞始点のある範囲, _前方閉塞一覧);
+        i->状態更新(地上子, _信号速度表, 信号インデックスを更新する);
+        信号グラフ再計算(std::distance(_前方閉塞一覧.begin(), i) + 1);
+        return i;
     }
 
     void 信号順守::前方閉塞信号を推定()
@@ -498,15 +563,109 @@ namespace autopilot
         }
     }
 
-    void 信号順守::信号グラフ再計算()
+    void 信号順守::信号グラフ再計算(std::size_t 変更閉塞番号)
+    {
+        // 変更のあった閉塞より手前の閉塞の制限区間はそのまま残す。
+        // 残せない時は最初から全部追加し直す。
+        if (変更閉塞番号 >= _閉塞記録点.size() ||
+            !_信号グラフ.記録点まで戻す(_閉塞記録点[変更閉塞番号]))
+        {
+            _信号グラフ.消去();
+            変更閉塞番号 = 0;
+        }
+        _閉塞記録点.resize(変更閉塞番号);
+
+        bool atc = is_atc();
+        std::size_t 閉塞数 = _前方閉塞一覧.size() + 1;
+        for (std::size_t i = 変更閉塞番号; i < 閉塞数; i++) {
+            _閉塞記録点.push_back(_信号グラフ.現在記録点());
+            番号の閉塞(i).制限グラフに追加(
+                _信号グラフ, _tasc目標停止位置, atc);
+        }
+        _閉塞記録点.push_back(_信号グラフ.現在記録点());
+
+#ifndef NDEBUG
+        制限グラフ 全再計算グラフ;
+        信号グラフ全再計算(全再計算グラフ);
+        assert(_信号グラフ.等しい(全再計算グラフ));
+#endif
+    }
+
+    void 信号順守::信号グラフ全再計算(制限グラフ &グラフ) const
     {
-        _信号グラフ.消去();
+        グラフ.消去();
 
         bool atc = is_atc();
-        _現在閉塞.制限グラフに追加(_信号グラフ, _tasc目標停止位置, atc);
+        _現在閉塞.制限グラフに追加(グラフ, _tasc目標停止位置, atc);
+        for (const 閉塞型 &閉塞 : _前方閉塞一覧) {
+            閉塞.制限グラフに追加(グラフ, _tasc目標停止位置, atc);
+        }
+    }
+
+    namespace
+    {
+
+        void 閉塞保存(状態書込 &書込, const 信号順守::閉塞型 &閉塞)
+        {
+            書込.値(閉塞.信号指示);
+            書込.値(閉塞.信号速度);
+            書込.値(閉塞.始点のある範囲);
+            書込.値(閉塞.信号インデックス一覧);
+            書込.値(閉塞.停止解放);
+            書込.個数(閉塞.停止信号前照査一覧.size());
+            for (const auto &照査 : 閉塞.停止信号前照査一覧) {
+                書込.値(照査.first);
+                書込.値(照査.second);
+            }
+        }
+
+        void 閉塞復元(状態読込 &読込, 信号順守::閉塞型 &閉塞)
+        {
+            読込.値(閉塞.信号指示);
+            読込.値(閉塞.信号速度);
+            読込.値(閉塞.始点のある範囲);
+            読込.値(閉塞.信号インデックス一覧);
+            読込.値(閉塞.停止解放);
+            std::size_t 個数 = 読込.個数(sizeof(m) + sizeof(mps));
+            閉塞.停止信号前照査一覧.clear();
+            for (std::size_t i = 0; i < 個数; i++) {
+                m 位置;
+                mps 速度;
+                読込.値(位置);
+                読込.値(速度);
+                閉塞.停止信号前照査一覧.emplace_hint(
+                    閉塞.停止信号前照査一覧.end(), 位置, 速度);
+            }
+        }
+
+    }
+
+    void 信号順守::状態保存(状態書込 &書込) const
+    {
+        書込.値(_信号速度表);
+        閉塞保存(書込, _現在閉塞);
+        書込.個数(_前方閉塞一覧.size());
         for (const 閉塞型 &閉塞 : _前方閉塞一覧) {
-            閉塞.制限グラフに追加(_信号グラフ, _tasc目標停止位置, atc);
+            閉塞保存(書込, 閉塞);
+        }
+        書込.値(_tasc目標停止位置);
+        _信号グラフ.状態保存(書込);
+        書込.一覧(_閉塞記録点);
+    }
+
+    void 信号順守::状態復元(状態読込 &読込)
+    {
+        読込.値(_信号速度表);
+        閉塞復元(読込, _現在閉塞);
+        std::size_t 個数 = 読込.個数();
+        // 閉塞の数は少ないので一旦空にしてから閉塞メモリで作り直す
+        _前方閉塞一覧.clear();
+        for (std::size_t i = 0; i < 個数; i++) {
+            閉塞復元(読込, _前方閉塞一覧.emplace_back());
         }
+        読込.値(_tasc目標停止位置);
+        _信号グラフ.状態復元(読込);
+        読込.一覧(_閉塞記録点);
     }
 
 }
@@ -18,12 +18,18 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
-#include <deque>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
 #include <limits>
 #include <map>
+#include <memory_resource>
+#include <utility>
+#include <vector>
 #include "制御指令.h"
 #include "制限グラフ.h"
 #include "区間.h"
+#include "地上子振り分け.h"
 #include "物理量.h"
 
 #pragma warning(push)
@@ -33,6 +39,9 @@ namespace autopilot
 {
 
     class 共通状態;
+    class 状態書込;
+    class 状態読込;
+    enum class 互換モード型;
 
     class 信号順守
     {
@@ -41,17 +50,74 @@ namespace autopilot
 
         enum class 発進方式 { 手動, 自動, };
 
+        /// 信号インデックスから信号速度を引く表。信号インデックスは
+        /// 0 から 255 までなので配列に並べ、速度の決まっていない所には
+        /// 不明 を入れておく。
+        class 信号速度表型
+        {
+        public:
+            static constexpr std::size_t 大きさ = 256;
+            static constexpr mps 不明{-1.0};
+
+            constexpr 信号速度表型() : _速度{} {
+                for (mps &速度 : _速度) {
+                    速度 = 不明;
+                }
+            }
+            constexpr 信号速度表型(
+                std::initializer_list<std::pair<信号インデックス, mps>> 一覧) :
+                信号速度表型{}
+            {
+                for (const auto &項目 : 一覧) {
+                    _速度[項目.first] = 項目.second;
+                }
+            }
+
+            /// 範囲外や速度の決まっていない信号インデックスなら 不明 を返す
+            constexpr mps operator[](信号インデックス 指示) const {
+                return 範囲内(指示) ?
+                    _速度[static_cast<std::size_t>(指示)] : 不明;
+            }
+            /// 範囲外の信号インデックスは無視する
+            void 設定(信号インデックス 指示, mps 速度) {
+                if (範囲内(指示)) {
+                    _速度[static_cast<std::size_t>(指示)] = 速度;
+                }
+            }
+
+        private:
+            std::array<mps, 大きさ> _速度;
+
+            static constexpr bool 範囲内(信号インデックス 指示) {
+                return 0 <= 指示 && 指示 < static_cast<信号インデックス>(大きさ);
+            }
+        };
+
         struct 閉塞型 {
             static constexpr 信号インデックス 無指示 =
                 std::numeric_limits<信号インデックス>::min();
 
+            // 停止信号前照査一覧 のメモリは 信号順守 の持つプールから取る
+            using allocator_type =
+                std::pmr::map<m, mps>::allocator_type;
+
             信号インデックス 信号指示 = 無指示;
             mps 信号速度 = mps::無限大();
             区間 始点のある範囲 = 区間{m::無限大(), m::無限大()};
             int 信号インデックス一覧 = 0; // 信号現示受信地上子の値
             bool 停止解放 = false;
             // この閉塞の信号速度が 0 の時にだけ有効な制限速度の一覧
-            std::map<m, mps> 停止信号前照査一覧;
+            std::pmr::map<m, mps> 停止信号前照査一覧;
+
+            閉塞型() = default;
+            explicit 閉塞型(const allocator_type &割当) :
+                停止信号前照査一覧{割当} {}
+            閉塞型(const 閉塞型 &元, const allocator_type &割当);
+            閉塞型(閉塞型 &&元, const allocator_type &割当);
+            閉塞型(const 閉塞型 &) = default;
+            閉塞型(閉塞型 &&) = default;
+            閉塞型 &operator=(const 閉塞型 &) = default;
+            閉塞型 &operator=(閉塞型 &&) = default;
 
             bool 通過済(m 位置) const { return 始点のある範囲.通過済(位置); }
             int 先行列車位置() const;
@@ -64,18 +130,18 @@ namespace autopilot
                 const;
 
             void 信号速度更新(
-                const std::map<信号インデックス, mps> &速度表);
+                const 信号速度表型 &速度表);
             void 信号指示設定(
                 信号インデックス 指示,
-                const std::map<信号インデックス, mps> &速度表);
+                const 信号速度表型 &速度表);
             void 状態更新(
                 const ATS_BEACONDATA &地上子,
-                const std::map<信号インデックス, mps> &速度表,
+                const 信号速度表型 &速度表,
                 bool 信号インデックスを更新する);
             void 停止信号前照査設定(const ATS_BEACONDATA &地上子, m 現在位置);
-            void 統合(const 閉塞型 &統合元);
+            void 統合(閉塞型 &&統合元);
             void 先行列車位置から信号指示を推定(
-                int 閉塞数, const std::map<信号インデックス, mps> &速度表);
+                int 閉塞数, const 信号速度表型 &速度表);
         };
 
         // 7.5 km/h は C-ATS や CS-ATC ORP の 最低照査速度による。
@@ -90,6 +156,8 @@ namespace autopilot
         void tasc目標停止位置変化(区間 位置のある範囲);
         void 地上子通過(
             const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        /// 指定した互換モードで 地上子通過 が処理する種類の地上子を登録する
+        void 地上子処理登録(地上子振り分け &振り分け, 互換モード型 モード);
 
         void 経過(const 共通状態 &状態);
 
@@ -105,10 +173,19 @@ namespace autopilot
         mps 現在制限速度(const 共通状態 &状態) const;
         mps 現在常用パターン速度(const 共通状態 &状態) const;
 
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+
     private:
-        std::map<信号インデックス, mps> _信号速度表;
+        信号速度表型 _信号速度表;
+        // 閉塞とその停止信号前照査一覧のためのメモリ。閉塞を消したり
+        // リセットしたりしても返さずに次の閉塞で使い回す。
+        // 閉塞より先に作り、後に壊すため最初に置く。
+        std::pmr::unsynchronized_pool_resource _閉塞メモリ;
         閉塞型 _現在閉塞;
-        std::deque<閉塞型> _前方閉塞一覧;
+        // 先頭から消すが、閉塞の数は少ないので配列で十分。
+        // 毎回メモリを確保し直さないように確保したメモリは残す
+        std::pmr::vector<閉塞型> _前方閉塞一覧;
 
         // どうせ tasc目標停止位置変化 がすぐ呼ばれるので初期値は何でも良い
         m _tasc目標停止位置 = {};
@@ -116,13 +193,36 @@ namespace autopilot
         // 経過メソッドが呼ばれる度に毎回制限グラフを計算するのはメモリに
         // 優しくないので予め計算しておく
         制限グラフ _信号グラフ;
+        // 各閉塞の制限区間を _信号グラフ に追加する直前の記録点。
+        // [0] は現在閉塞、[k] は前方閉塞一覧の k - 1 番目の閉塞の分で、
+        // 最後に全ての閉塞を追加した後の記録点がある。
+        std::vector<制限グラフ::記録点> _閉塞記録点;
+
+        const 閉塞型 &番号の閉塞(std::size_t 番号) const {
+            return 番号 == 0 ? _現在閉塞 : _前方閉塞一覧[番号 - 1];
+        }
 
         void 信号速度更新();
-        閉塞型 *信号現示受信(
+        std::pmr::vector<閉塞型>::iterator 信号現示受信(
             const ATS_BEACONDATA &地上子, m 直前位置,
             const 共通状態 &状態, bool 信号インデックスを更新する);
         void 前方閉塞信号を推定();
-        void 信号グラフ再計算();
+        /// 指定した番号以降の閉塞の制限区間だけを追加し直す
+        void 信号グラフ再計算(std::size_t 変更閉塞番号 = 0);
+        void 信号グラフ全再計算(制限グラフ &グラフ) const;
+
+        // 地上子の種類ごとの処理。互換モードは呼ぶ側で確かめる
+        template<bool 信号インデックスを更新する>
+        void 信号現示地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態) {
+            信号現示受信(地上子, 直前位置, 状態, 信号インデックスを更新する);
+        }
+        void 停止信号前速度地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        void 信号速度地上子(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態);
+        template<互換モード型 モード>
+        void 互換モード別登録(地上子振り分け &振り分け);
     };
 
 }
@@ -0,0 +1,174 @@
+// 停止予測.cpp : TASC の制御を先まで模擬して停止位置を予測します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+#include "停止予測.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include "制動特性.h"
+#include "制御指令.h"
+#include "物理量.h"
+
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    namespace
+    {
+
+        // 減速パターン が全力で力行する時に想定するのと同じ加速度
+        constexpr mps2 最大力行加速度 = 5.0_kmphps;
+        /// 空走時間の間に出力した目標加速度を覚えておく刻みの数
+        constexpr std::size_t 空走記録数 = 16;
+
+        /// ハンドル位置に対して勾配の影響を除いた加速度が近付いていく値
+        mps2 目標加速度(const ATS_HANDLES &ハンドル, const 共通状態 &状態)
+        {
+            const 制動特性 &制動 = 状態.制動();
+            制動指令 制動ノッチ{ハンドル.Brake};
+            if (制動.非常ブレーキである(手動制動自然数ノッチ{
+                static_cast<unsigned>(std::max(ハンドル.Brake, 0))}))
+            {
+                // 非常ブレーキの減速度は分からないので常用最大で代える
+                return -制動.減速度(制動.自動最大ノッチ());
+            }
+            if (制動ノッチ.value > 0) {
+                return -制動.減速度(制動.自動ノッチ(制動ノッチ));
+            }
+            if (ハンドル.Power > 0 && ハンドル.Reverser > 0) {
+                return 最大力行加速度 * static_cast<double>(ハンドル.Power) /
+                    static_cast<double>(
+                        std::max(状態.車両仕様().PowerNotches, 1));
+            }
+            return 0.0_mps2;
+        }
+
+    }
+
+    void 停止予測::準備(const 共通状態 &状態)
+    {
+        _予測状態 = 状態;
+        消去();
+    }
+
+    void 停止予測::消去()
+    {
+        _停止する = false;
+        _停止誤差 = m::quiet_NaN();
+        _ノッチ変化数 = 0;
+    }
+
+    void 停止予測::予測(const 共通状態 &状態, const tasc &tasc, bool 力行可)
+    {
+        消去();
+        m 目標停止位置 = tasc.目標停止位置();
+        if (状態.停車中()) {
+            _停止する = true;
+            _停止誤差 = 状態.現在位置() - 目標停止位置;
+            return;
+        }
+
+        // 全力で力行して下っても予測時間内に目標停止位置に届かないなら
+        // TASC はまだ止めにかからないので模擬しない
+        mps2 最大加速度 =
+            最大力行加速度 + std::max(状態.勾配().最大勾配加速度(), 0.0_mps2);
+        m 最大走行距離 = 状態.現在速度() * 予測時間 +
+            最大加速度 * 予測時間 * 予測時間 / 2.0;
+        if (目標停止位置 - 状態.現在位置() > 最大走行距離) {
+            return;
+        }
+
+        _予測状態.状態を写す(状態);
+        _予測tasc.制御状態を写す(tasc);
+
+        // 時定数の小さすぎる推定値で一次遅れが発散しないようにする
+        double 追従率 = std::min(刻み / 状態.制動().推定反応時間(), 1.0);
+        mps2 機械加速度 = 状態.加速度() - 状態.車両勾配加速度();
+        if (!isfinite(機械加速度)) {
+            機械加速度 = 0.0_mps2;
+        }
+
+        // 反応時間 (空走時間) だけ前の目標加速度に追従する。減速パターン
+        // と同じく、空走時間の間は今の加速度が続くものとする
+        double 空走段数 = std::clamp(状態.制動().反応時間() / 刻み,
+            0.0, static_cast<double>(空走記録数 - 2));
+        auto 空走整数段数 = static_cast<std::size_t>(空走段数);
+        double 空走端数 = 空走段数 - static_cast<double>(空走整数段数);
+        std::array<mps2, 空走記録数> 目標記録;
+        目標記録.fill(機械加速度);
+        m 位置 = 状態.現在位置();
+        mps 速度 = 状態.現在速度();
+        s 時刻 = 状態.現在時刻();
+        ATS_HANDLES ハンドル = {
+            状態.前回制動指令().value, 状態.前回力行ノッチ(),
+            状態.前回逆転器ノッチ(), ATS_CONSTANTSPEED_CONTINUE};
+        ATS_VEHICLESTATE 車両状態 = {};
+
+        int 段数 = static_cast<int>(予測時間 / 刻み);
+        for (int i = 0; i < 段数; i++) {
+            auto 今回 = static_cast<std::size_t>(i) % 空走記録数;
+            目標記録[今回] = 目標加速度(ハンドル, _予測状態);
+            auto 遅れ = [&](std::size_t 刻み数) {
+                return 目標記録[(今回 + 空走記録数 - 刻み数) % 空走記録数];
+            };
+            mps2 遅れた目標加速度 =
+                遅れ(空走整数段数) * (1.0 - 空走端数) +
+                遅れ(空走整数段数 + 1) * 空走端数;
+            機械加速度 += (遅れた目標加速度 - 機械加速度) * 追従率;
+            mps2 加速度 = 機械加速度 + _予測状態.車両勾配加速度();
+            mps 新速度 = 速度 + 加速度 * 刻み;
+            if (新速度 <= 0.0_mps) {
+                // 刻みの途中で止まる
+                位置 += 速度 * 速度 / (-2.0 * 加速度);
+                _停止する = true;
+                _停止誤差 = 位置 - 目標停止位置;
+                return;
+            }
+            位置 += (速度 + 新速度) / 2.0 * 刻み;
+            速度 = 新速度;
+            時刻 += 刻み;
+
+            車両状態.Location = 位置.value;
+            車両状態.Speed = static_cast<float>(static_cast<kmph>(速度).value);
+            車両状態.Time = static_cast<int>(
+                std::lround(static_cast<ms>(時刻).value));
+            _予測状態.予測経過(車両状態);
+            _予測tasc.経過(_予測状態);
+
+            自動制御指令 自動ノッチ = std::min(
+                自動制御指令{_予測状態.最大力行ノッチ()},
+                _予測tasc.出力ノッチ());
+            if (!力行可) {
+                自動ノッチ = std::min(自動ノッチ, 自動制御指令{力行ノッチ{0}});
+            }
+            ATS_HANDLES 新ハンドル = _予測状態.出力ハンドル位置(自動ノッチ);
+            if (新ハンドル.Brake != ハンドル.Brake ||
+                新ハンドル.Power != ハンドル.Power)
+            {
+                _ノッチ変化数++;
+            }
+            ハンドル = 新ハンドル;
+            _予測状態.出力(ハンドル);
+        }
+    }
+
+}
@@ -0,0 +1,71 @@
+// 停止予測.h : TASC の制御を先まで模擬して停止位置を予測します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+#include "tasc.h"
+#include "共通状態.h"
+#include "物理量.h"
+
+#pragma warning(push)
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    /// tasc と 共通状態 の複製を作り、簡単な車両の模型と組み合わせて
+    /// 一定の刻みで先まで走らせ、停止位置の誤差とノッチを変える回数を
+    /// 予測します。
+    /// 車両の加速度は、反応時間 (空走時間) だけ前に出力したノッチの
+    /// 減速度 (推定最大減速度による) に、推定反応時間を時定数とする
+    /// 一次遅れで追従するものとします。
+    /// 運転士の操作は変わらないものとし、ATO は考えません。
+    class 停止予測
+    {
+    public:
+        static constexpr s 刻み = 0.25_s;
+        static constexpr s 予測時間 = 30.0_s;
+
+        /// 設定を写す。設定ファイルを読み込んだ後に呼ぶ。
+        /// ここでは複製のメモリを確保してよい。
+        void 準備(const 共通状態 &状態);
+        void 消去();
+        /// 前に写した時より勾配区間が増えていなければメモリを確保しない。
+        /// 力行可 でなければ TASC が力行しても力行しないものとする。
+        void 予測(const 共通状態 &状態, const tasc &tasc, bool 力行可);
+
+        /// 予測時間内に停止すると予測したか。予測時間内に目標停止位置に
+        /// 届かないほど遠ければ模擬せずに停止しないとする
+        bool 停止する() const { return _停止する; }
+        /// 目標停止位置を行き過ぎる方を正とする。停止しなければ NaN
+        m 停止誤差() const { return _停止誤差; }
+        /// 停止するまで (停止しなければ予測時間の終わりまで) に
+        /// 出力するハンドル位置を変える回数
+        int ノッチ変化数() const { return _ノッチ変化数; }
+
+    private:
+        共通状態 _予測状態;
+        tasc _予測tasc;
+        bool _停止する = false;
+        m _停止誤差 = m::quiet_NaN();
+        int _ノッチ変化数 = 0;
+    };
+
+}
+
+#pragma warning(pop)
@@ -24,6 +24,7 @@
 #include <cstdlib>
 #include <limits>
 #include "物理量.h"
+#include "状態保存.h"
 
 #pragma warning(disable:4819)
 
@@ -52,8 +53,9 @@ namespace autopilot {
         _自動発進待ち時間 = s::quiet_NaN();
         _自動発進時刻 = s::quiet_NaN();
         _押しているキー.reset();
-        _加速度計.リセット();
+        _加速度計.設定(_設定.加速度推定方式(), _設定.加速度推定窓長());
         _勾配グラフ.消去();
+        キャッシュ無効化();
     }
 
     void 共通状態::車両仕様設定(const ATS_VEHICLESPEC & 仕様)
@@ -65,10 +67,12 @@ namespace autopilot {
             _設定.常用最大減速度(),
             _設定.制動反応時間(),
             _設定.pressure_rates());
+        キャッシュ無効化();
     }
 
     void 共通状態::地上子通過(const ATS_BEACONDATA &地上子, m 直前位置)
     {
+        キャッシュ無効化();
         switch (地上子.Type)
         {
         case 1001: // 互換モード設定
@@ -96,17 +100,74 @@ namespace autopilot {
         }
     }
 
+    void 共通状態::地上子処理登録(地上子振り分け &振り分け)
+    {
+        振り分け.登録({1001, 1002, 1003, 1008}, [](
+            void *対象, const ATS_BEACONDATA &地上子, m 直前位置,
+            const 共通状態 &)
+        {
+            static_cast<共通状態 *>(対象)->地上子通過(地上子, 直前位置);
+        }, this);
+    }
+
     void 共通状態::経過(const ATS_VEHICLESTATE & 状態)
+    {
+        予測経過(状態);
+        _制動特性.経過(*this);
+    }
+
+    void 共通状態::予測経過(const ATS_VEHICLESTATE & 状態)
     {
         _状態 = 状態;
         _加速度計.経過({ 現在速度(), 現在時刻() });
         _勾配グラフ.通過(現在位置() - 列車長());
-        _制動特性.経過(*this);
+        キャッシュ無効化();
+    }
+
+    ATS_HANDLES 共通状態::出力ハンドル位置(自動制御指令 自動ノッチ) const
+    {
+        if (_入力制動ノッチ > 手動制動自然数ノッチ{0} || _入力逆転器ノッチ <= 0) {
+            自動ノッチ = std::min(自動ノッチ, 自動制御指令{力行ノッチ{0}});
+        }
+
+        ATS_HANDLES ハンドル位置;
+        ハンドル位置.Brake = 出力制動指令(自動ノッチ.制動成分()).value;
+        if (_入力力行ノッチ >= 0) {
+            ハンドル位置.Power = std::max(
+                static_cast<int>(自動ノッチ.力行成分().value),
+                _入力力行ノッチ);
+        }
+        else {
+            ハンドル位置.Power = _入力力行ノッチ;
+        }
+        ハンドル位置.Reverser = _入力逆転器ノッチ;
+        ハンドル位置.ConstantSpeed = ATS_CONSTANTSPEED_CONTINUE;
+        return ハンドル位置;
+    }
+
+    制動指令 共通状態::出力制動指令(自動制動自然数ノッチ 自動ノッチ) const
+    {
+        if (_制動特性.非常ブレーキである(_入力制動ノッチ)) {
+            return _入力制動ノッチ; // 非常ブレーキは常に優先する
+        }
+        if (自動ノッチ == 自動制動自然数ノッチ{0}) {
+            return _入力制動ノッチ;
+        }
+
+        mps2 手動 = _制動特性.減速度(_入力制動ノッチ);
+        mps2 自動 = _制動特性.減速度(自動ノッチ);
+        if (手動 >= 自動) {
+            return _入力制動ノッチ;
+        }
+        else {
+            return _制動特性.指令(自動ノッチ);
+        }
     }
 
     void 共通状態::出力(const ATS_HANDLES & 出力)
     {
         _前回出力 = 出力;
+        キャッシュ無効化();
     }
 
     void 共通状態::戸閉(bool 戸閉)
@@ -175,7 +236,28 @@ namespace autopilot {
 
     mps2 共通状態::車両勾配加速度() const
     {
-        return _勾配グラフ.勾配加速度(現在範囲());
+        if (_車両勾配加速度世代 == _キャッシュ世代) {
+            _キャッシュ効果.車両勾配加速度.再利用回数++;
+            return _車両勾配加速度;
+        }
+
+        _車両勾配加速度世代 = _キャッシュ世代;
+        _車両勾配加速度 = _勾配グラフ.勾配加速度(現在範囲());
+        _キャッシュ効果.車両勾配加速度.計算回数++;
+        return _車両勾配加速度;
+    }
+
+    自動制動自然数ノッチ 共通状態::前回自動制動ノッチ() const
+    {
+        if (_前回自動制動ノッチ世代 == _キャッシュ世代) {
+            _キャッシュ効果.前回自動制動ノッチ.再利用回数++;
+            return _前回自動制動ノッチ;
+        }
+
+        _前回自動制動ノッチ世代 = _キャッシュ世代;
+        _前回自動制動ノッチ = _制動特性.自動ノッチ(前回制動指令());
+        _キャッシュ効果.前回自動制動ノッチ.計算回数++;
+        return _前回自動制動ノッチ;
     }
 
     void 共通状態::勾配追加(int 地上子値, m 直前位置)
@@ -198,4 +280,63 @@ namespace autopilot {
         _勾配グラフ.勾配区間追加(勾配変化地点, 勾配);
     }
 
+    void 共通状態::状態保存(状態書込 &書込) const
+    {
+        書込.値(_互換モード);
+        書込.値(_状態);
+        書込.値(_目安減速度);
+        書込.値(_戸閉);
+        書込.値(_自動発進待ち時間);
+        書込.値(_自動発進時刻);
+        書込.値(_入力逆転器ノッチ);
+        書込.値(_入力力行ノッチ);
+        書込.値(_入力制動ノッチ);
+        書込.値(static_cast<std::uint64_t>(_押しているキー.to_ullong()));
+        _加速度計.状態保存(書込);
+        _制動特性.状態保存(書込);
+        _勾配グラフ.状態保存(書込);
+        書込.値(_前回出力);
+    }
+
+    void 共通状態::状態復元(状態読込 &読込)
+    {
+        読込.値(_互換モード);
+        読込.値(_状態);
+        読込.値(_目安減速度);
+        読込.値(_戸閉);
+        読込.値(_自動発進待ち時間);
+        読込.値(_自動発進時刻);
+        読込.値(_入力逆転器ノッチ);
+        読込.値(_入力力行ノッチ);
+        読込.値(_入力制動ノッチ);
+        std::uint64_t 押しているキー;
+        読込.値(押しているキー);
+        _押しているキー = キー組合せ{押しているキー};
+        _加速度計.状態復元(読込);
+        _制動特性.状態復元(読込);
+        _勾配グラフ.状態復元(読込);
+        読込.値(_前回出力);
+        キャッシュ無効化();
+    }
+
+    void 共通状態::状態を写す(const 共通状態 &元)
+    {
+        _互換モード = 元._互換モード;
+        _車両仕様 = 元._車両仕様;
+        _状態 = 元._状態;
+        _目安減速度 = 元._目安減速度;
+        _戸閉 = 元._戸閉;
+        _自動発進待ち時間 = 元._自動発進待ち時間;
+        _自動発進時刻 = 元._自動発進時刻;
+        _入力逆転器ノッチ = 元._入力逆転器ノッチ;
+        _入力力行ノッチ = 元._入力力行ノッチ;
+        _入力制動ノッチ = 元._入力制動ノッチ;
+        _押しているキー = 元._押しているキー;
+        _加速度計 = 元._加速度計;
+        _制動特性 = 元._制動特性;
+        _勾配グラフ = 元._勾配グラフ;
+        _前回出力 = 元._前回出力;
+        キャッシュ無効化();
+    }
+
 }
@@ -18,10 +18,13 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
+#include <cstdint>
+#include <type_traits>
 #include "制動特性.h"
 #include "制御指令.h"
 #include "加速度計.h"
 #include "勾配グラフ.h"
+#include "地上子振り分け.h"
 #include "区間.h"
 #include "環境設定.h"
 #include "物理量.h"
@@ -32,6 +35,9 @@
 
 namespace autopilot {
 
+    class 状態書込;
+    class 状態読込;
+
     enum class 互換モード型
     {
         無効,
@@ -40,16 +46,47 @@ namespace autopilot {
         swp2,
     };
 
+    /// 互換モードを型にして 処理(std::integral_constant<互換モード型, …>)
+    /// を呼ぶ。互換モードごとに別々の処理を実体化するために使う。
+    /// 知らない互換モードは無効として扱う。
+    template<typename F>
+    void 互換モード別(互換モード型 モード, F &&処理)
+    {
+        using 型 = 互換モード型;
+        switch (モード) {
+        case 型::汎用ats:
+            処理(std::integral_constant<型, 型::汎用ats>{});
+            break;
+        case 型::メトロ総合:
+            処理(std::integral_constant<型, 型::メトロ総合>{});
+            break;
+        case 型::swp2:
+            処理(std::integral_constant<型, 型::swp2>{});
+            break;
+        default:
+            処理(std::integral_constant<型, 型::無効>{});
+            break;
+        }
+    }
+
     class 共通状態
     {
     public:
         void リセット();
         void 設定ファイル読込(LPCWSTR 設定ファイル名) {
             _設定.ファイル読込(設定ファイル名);
+            キャッシュ無効化();
         }
         void 車両仕様設定(const ATS_VEHICLESPEC & 仕様);
         void 地上子通過(const ATS_BEACONDATA &地上子, m 直前位置);
+        /// 地上子通過 で処理する種類の地上子を登録する
+        void 地上子処理登録(地上子振り分け &振り分け);
         void 経過(const ATS_VEHICLESTATE & 状態);
+        /// 予測した走行のための 経過。予測した走行からは制動力を推定しない
+        void 予測経過(const ATS_VEHICLESTATE & 状態);
+        /// 運転士の操作と自動ノッチを組み合わせて出力するハンドル位置を
+        /// 決める。運転士が制動している時や逆転器が前でない時は力行しない
+        ATS_HANDLES 出力ハンドル位置(自動制御指令 自動ノッチ) const;
         void 出力(const ATS_HANDLES & 出力);
         void 戸閉(bool 戸閉);
         void 逆転器操作(int ノッチ);
@@ -91,6 +128,8 @@ namespace autopilot {
         int 入力力行ノッチ() const { return _入力力行ノッチ; }
         手動制動自然数ノッチ 入力制動ノッチ() const { return _入力制動ノッチ; }
         mps2 加速度() const { return _加速度計.加速度(); }
+        /// 最小二乗 で推定している時の速度の雑音の大きさ。それ以外は NaN
+        mps 速度雑音() const { return _加速度計.速度雑音(); }
         const 制動特性 & 制動() const { return _制動特性; }
         自動制動自然数ノッチ 転動防止自動ノッチ() const;
         const 勾配グラフ &勾配() const { return _勾配グラフ; }
@@ -100,8 +139,30 @@ namespace autopilot {
         /// 抑速ノッチでは値は負になる
         int 前回力行ノッチ() const { return _前回出力.Power; }
         制動指令 前回制動指令() const { return 制動指令{_前回出力.Brake}; }
+        /// 制動().自動ノッチ(前回制動指令()) と同じ
+        自動制動自然数ノッチ 前回自動制動ノッチ() const;
         キー組合せ 押しているキー() const { return _押しているキー; }
 
+        /// フレーム内キャッシュを使った回数
+        struct キャッシュ統計
+        {
+            std::uint64_t 計算回数 = 0, 再利用回数 = 0;
+        };
+        struct フレーム内キャッシュ統計
+        {
+            キャッシュ統計 車両勾配加速度, 前回自動制動ノッチ;
+        };
+        const フレーム内キャッシュ統計 &キャッシュ効果() const {
+            return _キャッシュ効果;
+        }
+
+        /// 設定と車両仕様は保存・復元しない (先に読み込んでおく)
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+        /// 設定以外の状態を 元 と同じにする (停止予測の複製に使う)。
+        /// 設定は先に 元 を丸ごと代入して写しておく。
+        void 状態を写す(const 共通状態 &元);
+
     private:
         環境設定 _設定;
         互換モード型 _互換モード = 互換モード型::無効;
@@ -119,6 +180,18 @@ namespace autopilot {
         勾配グラフ _勾配グラフ;
         ATS_HANDLES _前回出力 = {};
 
+        // 経過・地上子通過・出力の間は変わらない派生値のキャッシュ。
+        // 世代が _キャッシュ世代 と違う値は無効。
+        // (進路勾配加速度 は呼ぶたびに目標位置が違うのでキャッシュしない)
+        std::uint64_t _キャッシュ世代 = 1;
+        mutable std::uint64_t _車両勾配加速度世代 = 0;
+        mutable mps2 _車両勾配加速度 = {};
+        mutable std::uint64_t _前回自動制動ノッチ世代 = 0;
+        mutable 自動制動自然数ノッチ _前回自動制動ノッチ;
+        mutable フレーム内キャッシュ統計 _キャッシュ効果;
+
+        void キャッシュ無効化() { _キャッシュ世代++; }
+        制動指令 出力制動指令(自動制動自然数ノッチ 自動ノッチ) const;
         void 勾配追加(int 地上子値, m 直前位置);
     };
 
@@ -0,0 +1,90 @@
+// 処理時間計測.cpp : フレームごとに各部の処理時間を記録します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+#include "処理時間計測.h"
+
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    処理時間計測 処理時間計測::記録;
+
+#ifdef AUTOPILOT_PROFILE
+
+    namespace
+    {
+
+        constexpr const char *区分名[計測区分数] = {
+            "全体",
+            "共通状態",
+            "地上子通過執行",
+            "tasc",
+            "ato",
+            "信号順守",
+            "orp",
+            "早着防止",
+            "急動作抑制",
+            "制限グラフ",
+            "停止予測",
+            "パネル出力",
+        };
+
+    }
+
+    void 処理時間計測::リセット()
+    {
+        _現在位置 = 0;
+        _記録済数 = 0;
+    }
+
+    void 処理時間計測::フレーム開始(int 時刻)
+    {
+        if (_記録済数 > 0) {
+            _現在位置 = (_現在位置 + 1) % 記録数;
+        }
+        if (_記録済数 < 記録数) {
+            _記録済数++;
+        }
+        _記録[_現在位置] = フレーム記録{時刻, {}, {}};
+    }
+
+    void 処理時間計測::書出(std::ostream &出力先) const
+    {
+        出力先 << "time_ms";
+        for (const char *名前 : 区分名) {
+            出力先 << '\t' << 名前 << "_ns\t" << 名前 << "_calls";
+        }
+        出力先 << '\n';
+
+        std::size_t 先頭 = (_現在位置 + 記録数 + 1 - _記録済数) % 記録数;
+        for (std::size_t i = 0; i < _記録済数; i++) {
+            const フレーム記録 &フレーム = _記録[(先頭 + i) % 記録数];
+            出力先 << フレーム.時刻;
+            for (std::size_t j = 0; j < 計測区分数; j++) {
+                出力先 << '\t' << フレーム.時間[j] << '\t' << フレーム.回数[j];
+            }
+            出力先 << '\n';
+        }
+    }
+
+#endif
+
+}
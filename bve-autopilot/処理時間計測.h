@@ -0,0 +1,144 @@
+// 処理時間計測.h : フレームごとに各部の処理時間を記録します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+// AUTOPILOT_PROFILE マクロを定義してビルドしたときだけ計測を行う。
+// 定義しないときは計測区間は何もしない空のオブジェクトになり、
+// 最適化によって完全に消える。
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#ifdef AUTOPILOT_PROFILE
+#include <array>
+#include <chrono>
+#endif
+
+#pragma warning(push)
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    /// 処理時間を計測する Main::経過 の各部
+    enum class 計測区分 : std::size_t
+    {
+        全体,
+        共通状態,
+        地上子通過執行,
+        tasc,
+        ato,
+        信号順守,
+        orp,
+        早着防止,
+        急動作抑制,
+        制限グラフ,
+        停止予測,
+        パネル出力,
+    };
+
+    constexpr std::size_t 計測区分数 =
+        static_cast<std::size_t>(計測区分::パネル出力) + 1;
+
+#ifdef AUTOPILOT_PROFILE
+
+    /// 直近のフレームの処理時間と呼出し回数を固定長のリングバッファーに
+    /// 記録します。
+    class 処理時間計測
+    {
+    public:
+        static constexpr bool 有効 = true;
+        static constexpr std::size_t 記録数 = 4096; // 20 ms 毎で約 80 秒
+
+        /// プラグイン全体で共有する記録
+        static 処理時間計測 記録;
+
+        void リセット();
+        void フレーム開始(int 時刻);
+        void 加算(計測区分 区分, std::chrono::nanoseconds 時間) {
+            if (_記録済数 == 0) {
+                return; // 最初の経過より前の呼出しは記録しない
+            }
+            フレーム記録 &現在 = _記録[_現在位置];
+            std::size_t i = static_cast<std::size_t>(区分);
+            現在.時間[i] += static_cast<std::uint32_t>(時間.count());
+            現在.回数[i]++;
+        }
+
+        /// 古いフレームから順にタブ区切りで書き出します。
+        void 書出(std::ostream &出力先) const;
+
+    private:
+        struct フレーム記録
+        {
+            int 時刻; // ms
+            std::uint32_t 時間[計測区分数]; // ns
+            std::uint16_t 回数[計測区分数];
+        };
+
+        std::array<フレーム記録, 記録数> _記録;
+        std::size_t _現在位置 = 0;
+        std::size_t _記録済数 = 0;
+    };
+
+    /// 生存期間中の処理時間を計測して 処理時間計測::記録 に加算します。
+    class 計測区間
+    {
+    public:
+        explicit 計測区間(計測区分 区分) :
+            _区分{区分}, _開始{std::chrono::steady_clock::now()} { }
+        ~計測区間() {
+            処理時間計測::記録.加算(
+                _区分, std::chrono::steady_clock::now() - _開始);
+        }
+        計測区間(const 計測区間 &) = delete;
+        計測区間 &operator=(const 計測区間 &) = delete;
+
+    private:
+        計測区分 _区分;
+        std::chrono::steady_clock::time_point _開始;
+    };
+
+#else
+
+    class 処理時間計測
+    {
+    public:
+        static constexpr bool 有効 = false;
+
+        static 処理時間計測 記録;
+
+        void リセット() { }
+        void フレーム開始(int) { }
+        void 書出(std::ostream &) const { }
+    };
+
+    class 計測区間
+    {
+    public:
+        explicit constexpr 計測区間(計測区分) noexcept { }
+        計測区間(const 計測区間 &) = delete;
+        計測区間 &operator=(const 計測区間 &) = delete;
+    };
+
+#endif
+
+}
+
+#pragma warning(pop)
@@ -19,7 +19,13 @@
 
 #include "stdafx.h"
 #include "制動力推定.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "共通状態.h"
+#include "状態保存.h"
+
+#pragma warning(disable:4819)
 
 namespace autopilot
 {
@@ -27,71 +33,139 @@ namespace autopilot
     namespace
     {
 
-        bool 圧力差が小さい(float 圧力1, float 圧力2) {
-            if (圧力1 == 圧力2) {
-                return true;
-            }
-            float 比 = 圧力1 / 圧力2;
-            return 0.999f <= 比 && 比 <= 1 / 0.999f;
-        }
+        /// これより前の観測の重みは e 分の 1 以下になる
+        constexpr s 記憶時間 = 5.0_s;
+        /// 加速度計から求めた減速度に含まれる誤差の標準偏差の目安 (m/s/s)
+        constexpr double 観測雑音 = 0.05;
+        /// 推定を始める時の推定値の標準偏差。
+        /// 最大減速度は基準最大減速度に対する比で表す
+        constexpr double 最大減速度初期誤差比 = 0.5;
+        constexpr double 反応時間初期誤差 = 0.5; // s
+        constexpr s 反応時間上限 = 3.0_s;
 
     }
 
-    void 制動力推定::経過(制動力割合 前回出力割合, const 共通状態 &状態)
+    void 制動力推定::性能設定(mps2 基準最大減速度, s 基準反応時間)
     {
-        if (_前回出力ノッチ != 状態.前回制動指令()) {
-            _前回出力ノッチ = 状態.前回制動指令();
-            _前回出力ノッチ変化時刻 = 状態.現在時刻();
-        }
+        _基準最大減速度 = 基準最大減速度;
+        _基準反応時間 = 基準反応時間;
+        推定を初期化();
+    }
 
-        制動力割合 割合 = 前回出力割合;
-        bool 割合安定 = 0.1 <= 割合.value && 割合.value <= 1.0;
-        if (割合安定 && 状態.現在電流() == 0 &&
-            abs(_前回出力ノッチ変化時刻 - 状態.現在時刻()) >=
-                状態.制動().反応時間() &&
-            圧力差が小さい(_前回観測圧力, 状態.現在ブレーキシリンダー圧()))
-        {
-            _推定最大圧力 = static_cast<float>(
-                状態.現在ブレーキシリンダー圧() / 割合.value);
-        }
-        else {
-            割合 = 制動力割合{状態.現在ブレーキシリンダー圧() / _推定最大圧力};
-            割合安定 = 0.1 <= 割合.value && 割合.value <= 1.0;
+    void 制動力推定::推定を初期化()
+    {
+        _推定最大減速度 = _基準最大減速度;
+        _推定反応時間 = _基準反応時間;
+        double 誤差D = 最大減速度初期誤差比 * _基準最大減速度.value;
+        _共分散DD = 誤差D * 誤差D;
+        _共分散Dτ = 0;
+        _共分散ττ = 反応時間初期誤差 * 反応時間初期誤差;
+        // 最初はずっと緩めていたものとする
+        _出力記録.fill({-s::無限大(), 制動力割合{0}});
+        _出力記録次 = 0;
+        _前回推定可 = false;
+    }
+
+    制動力割合 制動力推定::空走時間前の割合(s 現在時刻) const
+    {
+        s 時刻 = 現在時刻 - _基準反応時間;
+        std::size_t j = _出力記録次;
+        for (std::size_t i = 0; i < 出力記録数; i++) {
+            j = j > 0 ? j - 1 : 出力記録数 - 1;
+            if (_出力記録[j].時刻 <= 時刻) {
+                return _出力記録[j].割合;
+            }
         }
+        return 制動力割合{std::numeric_limits<double>::quiet_NaN()};
+    }
 
-        if (!割合安定 || 状態.現在電流() != 0) {
-            _前回不安定時刻 = 状態.現在時刻();
+    void 制動力推定::経過(制動力割合 前回出力割合, const 共通状態 &状態)
+    {
+        const 出力記録 &最新 =
+            _出力記録[_出力記録次 > 0 ? _出力記録次 - 1 : 出力記録数 - 1];
+        if (最新.割合 != 前回出力割合) {
+            _出力記録[_出力記録次] = {状態.現在時刻(), 前回出力割合};
+            _出力記録次 = (_出力記録次 + 1) % 出力記録数;
         }
 
-        if (状態.現在速度() >= static_cast<mps>(0.1_kmph)) {
-            if (abs(_前回不安定時刻 - 状態.現在時刻()) >= 0.5_s) {
-                最大減速度を推定(割合, 状態);
-            }
-            else {
-                _推定最大減速度 = _基準最大減速度;
-            }
+        // ブレーキシリンダー圧から割合を求めると、τ はシリンダー圧から
+        // 減速度までの遅れになってしまうので、出力した割合と比べる。
+        // 応答の遅れも推定するので、ノッチを変えた直後の観測も使う
+        制動力割合 割合 = 空走時間前の割合(状態.現在時刻());
+        bool 割合安定 = 0.1 <= 割合.value && 割合.value <= 1.0;
+        bool 推定可 = 割合安定 && 状態.現在電流() == 0 &&
+            状態.現在速度() >= static_cast<mps>(0.1_kmph);
+        mps2 出力減速度 = 状態.車両勾配加速度() - 状態.加速度();
+        s フレーム = 状態.現在時刻() - _前回観測時刻;
+        if (推定可 && _前回推定可 && 0.0_s < フレーム && フレーム < 1.0_s) {
+            最大減速度を推定(割合, 出力減速度, フレーム);
         }
 
-        _前回観測圧力 = 状態.現在ブレーキシリンダー圧();
+        _前回推定可 = 推定可;
+        _前回出力減速度 = 出力減速度;
         _前回観測時刻 = 状態.現在時刻();
     }
 
-    void 制動力推定::最大減速度を推定(制動力割合 割合, const 共通状態 &状態)
+    void 制動力推定::最大減速度を推定(
+        制動力割合 割合, mps2 出力減速度, s フレーム)
     {
-        s フレーム = 状態.現在時刻() - _前回観測時刻;
-        if (フレーム <= 0.0_s || 1.0_s <= フレーム) {
-            return;
-        }
+        // d = D × 割合 - τ × dd/dt の D と τ を求める
+        double x1 = 割合.value;
+        double x2 = -(出力減速度 - _前回出力減速度).value / フレーム.value;
+        double 誤差 = 出力減速度.value -
+            (_推定最大減速度.value * x1 + _推定反応時間.value * x2);
 
-        mps2 出力減速度 = 状態.車両勾配加速度() - 状態.加速度();
-        if (出力減速度 < static_cast<mps2>(0.1_kmphps)) {
-            return;
-        }
+        double Px1 = _共分散DD * x1 + _共分散Dτ * x2;
+        double Px2 = _共分散Dτ * x1 + _共分散ττ * x2;
+        double 忘却係数 = std::exp(-(フレーム / 記憶時間));
+        double 分母 = 忘却係数 * 観測雑音 * 観測雑音 + x1 * Px1 + x2 * Px2;
+        double K1 = Px1 / 分母, K2 = Px2 / 分母;
 
-        mps2 変化量上限 = 1.0_kmphps2 * フレーム;
-        mps2 新推定値 = 出力減速度 / 割合.value;
-        _推定最大減速度 = std::clamp(新推定値,
-            _推定最大減速度 - 変化量上限, _推定最大減速度 + 変化量上限);
+        mps2 D上限 = 2.0 * _基準最大減速度;
+        mps2 D下限 = 0.5 * _基準最大減速度;
+        _推定最大減速度 = std::clamp(
+            _推定最大減速度 + static_cast<mps2>(K1 * 誤差), D下限, D上限);
+        _推定反応時間 = std::clamp(
+            _推定反応時間 + static_cast<s>(K2 * 誤差), 0.0_s, 反応時間上限);
+
+        _共分散DD = (_共分散DD - K1 * Px1) / 忘却係数;
+        _共分散Dτ = (_共分散Dτ - K1 * Px2) / 忘却係数;
+        _共分散ττ = (_共分散ττ - K2 * Px2) / 忘却係数;
+
+        // 制動が続かない間に共分散が膨らみ続けないよう初期値で抑える
+        double 誤差D = 最大減速度初期誤差比 * _基準最大減速度.value;
+        _共分散DD = std::min(_共分散DD, 誤差D * 誤差D);
+        _共分散ττ = std::min(_共分散ττ, 反応時間初期誤差 * 反応時間初期誤差);
+        double 共分散上限 = std::sqrt(_共分散DD * _共分散ττ);
+        _共分散Dτ = std::clamp(_共分散Dτ, -共分散上限, 共分散上限);
+    }
+
+    void 制動力推定::状態保存(状態書込 &書込) const
+    {
+        書込.値(_推定最大減速度);
+        書込.値(_推定反応時間);
+        書込.値(_共分散DD);
+        書込.値(_共分散Dτ);
+        書込.値(_共分散ττ);
+        書込.値(_出力記録);
+        書込.値(_出力記録次);
+        書込.値(_前回観測時刻);
+        書込.値(_前回出力減速度);
+        書込.値(_前回推定可);
+    }
+
+    void 制動力推定::状態復元(状態読込 &読込)
+    {
+        読込.値(_推定最大減速度);
+        読込.値(_推定反応時間);
+        読込.値(_共分散DD);
+        読込.値(_共分散Dτ);
+        読込.値(_共分散ττ);
+        読込.値(_出力記録);
+        読込.値(_出力記録次);
+        読込.値(_前回観測時刻);
+        読込.値(_前回出力減速度);
+        読込.値(_前回推定可);
     }
 
 }
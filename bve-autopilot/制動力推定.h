@@ -18,6 +18,8 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
+#include <array>
+#include <cstddef>
 #include "制御指令.h"
 #include "物理量.h"
 
@@ -25,31 +27,59 @@ namespace autopilot
 {
 
     class 共通状態;
+    class 状態書込;
+    class 状態読込;
 
+    /// 実際の減速度から最大常用ブレーキの減速度と制動の応答の遅れを
+    /// 推定します。減速度が、基準反応時間 (空走時間) だけ前に出力した
+    /// 制動力割合に一次遅れで追従するとして、時定数 τ・最大減速度 D を
+    /// 逐次最小二乗法で求めます。
+    /// (τ dd/dt + d = D × 割合(t - 基準反応時間))
     class 制動力推定
     {
     public:
         mps2 基準最大減速度() const { return _基準最大減速度; }
-        void 基準最大減速度を設定(mps2 減速度) {
-            _基準最大減速度 = _推定最大減速度 = 減速度;
-        }
+        void 性能設定(mps2 基準最大減速度, s 基準反応時間);
         mps2 推定最大減速度() const { return _推定最大減速度; }
+        s 推定反応時間() const { return _推定反応時間; }
 
         void 経過(制動力割合 前回出力割合, const 共通状態 &状態);
 
+        /// 推定の途中経過を保存・復元する。基準値は 性能設定 のまま変えない
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+
     private:
         /// 環境設定で指定された、最大常用ブレーキの平均減速度
         mps2 _基準最大減速度 = {};
         /// 実際の制動力から推定した最大常用ブレーキの減速度
         mps2 _推定最大減速度 = {};
-        float _推定最大圧力 = 440;
-        float _前回観測圧力 = 0;
-        制動指令 _前回出力ノッチ;
-        s _前回出力ノッチ変化時刻 = {};
-        s _前回不安定時刻 = {};
+        /// 環境設定で指定された、制動の反応時間
+        s _基準反応時間 = {};
+        /// 空走時間の後の、実際の減速度の変化から推定した一次遅れの時定数
+        s _推定反応時間 = {};
+        /// (D, τ) の推定誤差の共分散行列 (対称なので 3 要素)
+        double _共分散DD = 0, _共分散Dτ = 0, _共分散ττ = 0;
+
+        struct 出力記録 {
+            s 時刻;
+            制動力割合 割合;
+        };
+        /// 空走時間の間にこれより多く割合を変えると推定を休む
+        static constexpr std::size_t 出力記録数 = 16;
+        /// 出力した制動力割合が変わった時刻と変えた後の割合。
+        /// _出力記録次 の一つ前が最新の環状の配列
+        std::array<出力記録, 出力記録数> _出力記録 = {};
+        std::size_t _出力記録次 = 0;
+
         s _前回観測時刻 = {};
+        mps2 _前回出力減速度 = {};
+        bool _前回推定可 = false;
 
-        void 最大減速度を推定(制動力割合 割合, const 共通状態 &状態);
+        void 推定を初期化();
+        /// 基準反応時間前に出力していた割合。記録が足りなければ NaN
+        制動力割合 空走時間前の割合(s 現在時刻) const;
+        void 最大減速度を推定(制動力割合 割合, mps2 出力減速度, s フレーム);
     };
 
 }
@@ -41,7 +41,7 @@ namespace autopilot
     {
         _標準最大ノッチ = 標準最大ノッチ;
         _反応時間 = 反応時間;
-        _制動力推定.基準最大減速度を設定(基準最大減速度);
+        _制動力推定.性能設定(基準最大減速度, 反応時間);
 
         auto 標準ノッチ数 =
             static_cast<pressure_rates::size_type>(標準最大ノッチ.value);
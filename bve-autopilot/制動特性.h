@@ -58,6 +58,12 @@ namespace autopilot
             return _制動力推定.推定最大減速度();
         }
         s 反応時間() const { return _反応時間; }
+        /// 実際の減速度の変化から推定した、反応時間 (空走時間) の後の
+        /// 一次遅れの時定数です。停止までの距離には同じ長さの
+        /// 空走時間と同程度に影響します。
+        s 推定反応時間() const {
+            return _制動力推定.推定反応時間();
+        }
 
         bool 非常ブレーキである(手動制動自然数ノッチ ノッチ) const {
             return ノッチ.value == _標準最大ノッチ.value + 1;
@@ -89,6 +95,15 @@ namespace autopilot
 
         void 経過(const 共通状態 &状態);
 
+        /// 制動力推定の状態だけを保存・復元します。
+        /// ノッチ列や基準値は 性能設定 で設定したままです。
+        void 状態保存(状態書込 &書込) const {
+            _制動力推定.状態保存(書込);
+        }
+        void 状態復元(状態読込 &読込) {
+            _制動力推定.状態復元(読込);
+        }
+
     private:
         /// 車両パラメーターファイルの PressureRates と同様に、ノッチごとの
         /// ブレーキ力の割合を示す数列です。
@@ -29,21 +29,86 @@
 #include "区間.h"
 #include "減速パターン.h"
 #include "物理量.h"
+#include "状態保存.h"
 
 #pragma warning(disable:4819)
 
 namespace autopilot
 {
 
-    struct 制限グラフ::制限区間
+    namespace
     {
-        m 減速目標地点;
-        mps 速度;
 
-        void 減速目標地点を再設定(m 新しい減速目標地点);
+        template<typename 区間型>
+        bool 始点が前(const 区間型 &区間, m 位置) {
+            return 区間.始点 < 位置;
+        }
+
+        template<typename 区間型>
+        bool 始点が後(m 位置, const 区間型 &区間) {
+            return 位置 < 区間.始点;
+        }
+
+        /// NaN を最小とみなす std::min
+        m 最小(m a, m b) {
+            return a < b || isnan(a) ? a : b;
+        }
+
+        /// NaN 同士を等しいとみなす ==
+        bool 同値(m a, m b) {
+            return a == b || (isnan(a) && isnan(b));
+        }
+
+        /// 現在位置からこの距離より先に減速目標地点がある制限区間では、
+        /// 減速パターン::出力ノッチ は必ず最大力行ノッチを返す。
+        /// そのような距離を保証できない状況では無限大を返す。
+        m 評価距離(const 共通状態 &状態)
+        {
+            // 出力減速度が 0 以下なら制動ノッチが 0 になること
+            const 制動特性 &制動 = 状態.制動();
+            if (!(制動.推定最大減速度() > 0.0_mps2) ||
+                制動.自動ノッチ(0.0_mps2) != 自動制動実数ノッチ{0.0} ||
+                制動.自動ノッチ丸め(自動制動実数ノッチ{0.25}) !=
+                    自動制動自然数ノッチ{0})
+            {
+                return m::無限大();
+            }
 
-        減速パターン 目標パターン(mps2 初期減速度) const;
-    };
+            // どの区間のパターンも少なくともこの減速度で速度が上がっていく
+            mps2 最小パターン減速度 = std::min(
+                状態.目安減速度() -
+                    std::max(状態.勾配().最大勾配加速度(), 0.0_mps2),
+                減速パターン::標準最終減速度);
+            if (!(最小パターン減速度 > 0.0_mps2)) {
+                return m::無限大();
+            }
+
+            // 減速パターン::出力ノッチ が現在状態から先の動きを予測する
+            // 範囲 (短く力行してから 5 秒惰行) での最高速度と走行距離
+            if (!isfinite(状態.加速度())) {
+                return m::無限大();
+            }
+            mps2 勾配影響 = std::max(状態.車両勾配加速度(), 0.0_mps2);
+            s 力行時間 = std::max(1.0_s, 状態.設定().加速終了遅延());
+            mps2 力行加速度 =
+                std::max(static_cast<mps2>(5.0_kmphps), 状態.加速度());
+            mps 最高速度 = std::max(状態.現在速度(), 0.0_mps) +
+                力行加速度 * 力行時間 + 5.0_s * 勾配影響;
+            m 走行距離 = 最高速度 * (力行時間 + 5.0_s);
+
+            // 期待速度がこれ以上なら出力減速度と勾配影響の和が 0 以下になる
+            mps2 最大期待減速度 = std::max(
+                状態.目安減速度(), 減速パターン::停止最終減速度);
+            mps 必要期待速度 =
+                最高速度 + 2.0_s * (最大期待減速度 + 勾配影響);
+            m 必要距離 = 必要期待速度 * 必要期待速度 /
+                (2.0 * 最小パターン減速度);
+
+            // 丸め誤差があっても大丈夫なように余裕を持たせる
+            return (走行距離 + 必要距離) * 1.125 + 100.0_m;
+        }
+
+    }
 
     制限グラフ::制限グラフ() = default;
     制限グラフ::~制限グラフ() = default;
@@ -51,42 +116,56 @@ namespace autopilot
     void 制限グラフ::消去()
     {
         _区間リスト.clear();
+        _通過済区間数 = 0;
+        _変更回数++;
     }
 
     void 制限グラフ::制限区間追加(m 減速目標地点, m 始点, mps 速度)
     {
-        // データを追加するだけなら
-        // _区間リスト.insert_or_assign(始点, 制限区間{減速目標地点, 速度});
-        // だけでもよいのだが、無駄に多くのデータを追加しないように
+        // データを追加するだけなら始点の位置に挿入するだけでもよいのだが、
+        // 無駄に多くのデータを追加しないように
         // 以下の長々としたコードで最適化する。
 
-        auto i = _区間リスト.lower_bound(始点);
+        // 通過済みの区間はここでまとめて消す
+        if (_通過済区間数 > 0) {
+            _区間リスト.erase(
+                _区間リスト.begin(), _区間リスト.begin() + _通過済区間数);
+            _通過済区間数 = 0;
+            _変更回数++;
+        }
+
+        auto i = std::lower_bound(_区間リスト.begin(), _区間リスト.end(),
+            始点, 始点が前<制限区間>);
 
         if (i != _区間リスト.end()) {
-            if (速度 == i->second.速度) {
+            // 末尾より前の区間を変更するので記録点まで戻せなくなる
+            _変更回数++;
+
+            if (速度 == i->速度) {
                 // 既に同じ制限速度の区間があるなら区間を追加しない
-                auto n = _区間リスト.extract(i++);
-                assert(始点 <= n.key());
-                n.key() = 始点;
-                n.mapped().減速目標地点を再設定(減速目標地点);
-                _区間リスト.insert(i, std::move(n));
+                assert(始点 <= i->始点);
+                i->始点 = 始点;
+                i->減速目標地点を再設定(減速目標地点);
+                以降最小減速目標地点更新(i);
                 return;
             }
 
-            if (始点 == i->first) {
+            if (始点 == i->始点) {
                 // 既に同じ位置に区間があるなら上書きする
-                i->second.減速目標地点 = 減速目標地点;
-                i->second.速度 = 速度;
+                i->減速目標地点 = 減速目標地点;
+                i->速度 = 速度;
+                以降最小減速目標地点更新(i);
                 return;
             }
         }
 
         if (i != _区間リスト.begin()) {
             auto j = std::prev(i);
-            assert(j->first < 始点);
-            if (速度 == j->second.速度) {
+            assert(j->始点 < 始点);
+            if (速度 == j->速度) {
                 // 既に同じ制限速度の区間があるなら区間を追加しない
-                j->second.減速目標地点を再設定(減速目標地点);
+                j->減速目標地点を再設定(減速目標地点);
+                以降最小減速目標地点更新(j);
                 return;
             }
         }
@@ -95,33 +174,91 @@ namespace autopilot
             return;
         }
 
-        auto j =
-            _区間リスト.try_emplace(i, 始点, 制限区間{減速目標地点, 速度});
-        assert(std::next(j) == i);
+        i = _区間リスト.insert(
+            i, 制限区間{始点, 減速目標地点, 速度, 減速目標地点});
+        以降最小減速目標地点更新(i);
     }
 
-    void 制限グラフ::通過(m 位置)
+    制限グラフ::記録点 制限グラフ::現在記録点() const
     {
-        if (_区間リスト.empty()) {
-            return;
+        m 末尾減速目標地点 = _区間リスト.empty() ?
+            m::無限大() : _区間リスト.back().減速目標地点;
+        return 記録点{_区間リスト.size(), _通過済区間数,
+            末尾減速目標地点, _変更回数};
+    }
+
+    bool 制限グラフ::記録点まで戻す(const 記録点 &戻り先)
+    {
+        // 記録点以降が末尾への追加と末尾の減速目標地点の再設定だけなら
+        // 後ろの区間を消して末尾の減速目標地点を戻せば元通りになる
+        if (戻り先.変更回数 != _変更回数 ||
+            戻り先.通過済区間数 != _通過済区間数 ||
+            戻り先.区間数 > _区間リスト.size())
+        {
+            return false;
+        }
+
+        _区間リスト.erase(
+            _区間リスト.begin() + 戻り先.区間数, _区間リスト.end());
+        if (!_区間リスト.empty()) {
+            _区間リスト.back().減速目標地点 = 戻り先.末尾減速目標地点;
+            以降最小減速目標地点更新(std::prev(_区間リスト.end()));
         }
+        return true;
+    }
+
+    bool 制限グラフ::等しい(const 制限グラフ &比較対象) const
+    {
+        return std::equal(未通過先頭(), _区間リスト.cend(),
+            比較対象.未通過先頭(), 比較対象._区間リスト.cend(),
+            [](const 制限区間 &a, const 制限区間 &b) {
+                return 同値(a.始点, b.始点) &&
+                    同値(a.減速目標地点, b.減速目標地点) &&
+                    a.速度 == b.速度 &&
+                    同値(a.以降最小減速目標地点, b.以降最小減速目標地点);
+            });
+    }
 
-        // 通過済みの区間を消す
-        auto i = _区間リスト.begin();
-        while (true) {
-            auto j = std::next(i);
-            if (j == _区間リスト.end() || j->first > 位置) {
+    void 制限グラフ::以降最小減速目標地点更新(区間リスト型::iterator i)
+    {
+        auto j = std::next(i);
+        m 後続最小 = j == _区間リスト.end() ?
+            m::無限大() : j->以降最小減速目標地点;
+
+        // i より前の区間は値が変わらなくなったところで打ち切る
+        for (bool 先頭 = true; ; 先頭 = false) {
+            m 新しい値 = 最小(i->減速目標地点, 後続最小);
+            bool 変化 = !(新しい値 == i->以降最小減速目標地点) &&
+                !(isnan(新しい値) && isnan(i->以降最小減速目標地点));
+            i->以降最小減速目標地点 = 新しい値;
+            if (!先頭 && !変化) {
+                break;
+            }
+            if (i == _区間リスト.begin()) {
                 break;
             }
-            i = j;
+            後続最小 = 新しい値;
+            --i;
+        }
+    }
+
+    void 制限グラフ::通過(m 位置)
+    {
+        std::size_t 区間数 = _区間リスト.size();
+        if (_通過済区間数 >= 区間数) {
+            return;
+        }
+
+        // 通過済みの区間を飛ばす
+        while (_通過済区間数 + 1 < 区間数 &&
+            _区間リスト[_通過済区間数 + 1].始点 <= 位置)
+        {
+            _通過済区間数++;
         }
-        i = _区間リスト.erase(_区間リスト.begin(), i);
-        assert(!_区間リスト.empty());
-        assert(i == _区間リスト.begin());
 
         // 速度が無制限の区間は未通過でも消す
-        if (i->second.速度 == mps::無限大()) {
-            _区間リスト.erase(i);
+        if (_区間リスト[_通過済区間数].速度 == mps::無限大()) {
+            _通過済区間数++;
         }
     }
 
@@ -131,15 +268,18 @@ namespace autopilot
             return mps::無限大();
         }
 
-        auto i = _区間リスト.upper_bound(対象区間.始点);
-        if (i != _区間リスト.begin()) {
+        auto 先頭 = 未通過先頭();
+        auto i = std::upper_bound(先頭, _区間リスト.cend(),
+            対象区間.始点, 始点が後<制限区間>);
+        if (i != 先頭) {
             --i;
         }
-        auto j = _区間リスト.upper_bound(対象区間.終点);
+        auto j = std::upper_bound(i, _区間リスト.cend(),
+            対象区間.終点, 始点が後<制限区間>);
 
         return std::accumulate(i, j, mps::無限大(),
-            [](mps 制限速度, const std::pair<const m, 制限区間> &p) {
-                return std::min(制限速度, p.second.速度);
+            [](mps 制限速度, const 制限区間 &区間) {
+                return std::min(制限速度, 区間.速度);
             });
     }
 
@@ -147,11 +287,22 @@ namespace autopilot
     {
         auto 速度 = mps::無限大();
         mps2 標準減速度 = 状態.制動().基準最大減速度();
+        // どの区間のパターンもこの減速度以上なので、始点までの距離が d の
+        // 区間のパターン速度は √(2 × 最小減速度 × d) より小さくならない
+        mps2 最小減速度 = 標準減速度 -
+            std::max(状態.勾配().最大勾配加速度(), 0.0_mps2);
 
-        for (const auto &[位置, 区間] : _区間リスト) {
-            mps2 勾配影響 = std::max(状態.進路勾配加速度(位置), 0.0_mps2);
+        for (auto i = 未通過先頭(); i != _区間リスト.end(); ++i) {
+            m 距離 = i->始点 - 状態.現在位置();
+            if (最小減速度 > 0.0_mps2 && 距離 > 0.0_m &&
+                速度 * 速度 <= 2.0 * 最小減速度 * 距離)
+            {
+                break; // 始点の昇順なのでこれ以降の区間も速度を下げない
+            }
+            mps2 勾配影響 =
+                std::max(状態.進路勾配加速度(i->始点), 0.0_mps2);
             mps2 目標減速度 = 標準減速度 - 勾配影響;
-            減速パターン パターン{位置, 区間.速度, 目標減速度};
+            減速パターン パターン{i->始点, i->速度, 目標減速度};
             速度 = std::min(速度, パターン.期待速度(状態.現在位置()));
         }
         return 速度;
@@ -159,16 +310,38 @@ namespace autopilot
 
     自動制御指令 制限グラフ::出力ノッチ(const 共通状態 &状態) const
     {
-        自動制御指令 ノッチ = 力行ノッチ{std::numeric_limits<unsigned>::max()};
+        _評価.消去();
+        評価対象追加(_評価, 状態, 0);
+        減速パターン::共通入力 入力{状態};
+        自動制御指令 ノッチ = _評価.評価(入力).ノッチ;
+        assert(ノッチ == 全区間出力ノッチ(入力));
+        return ノッチ;
+    }
 
-        for (const auto &[位置, 区間] : _区間リスト) {
-            mps2 勾配影響 = std::max(状態.進路勾配加速度(位置), 0.0_mps2);
-            mps2 目標減速度 = 状態.目安減速度() - 勾配影響;
-            減速パターン パターン = 区間.目標パターン(目標減速度);
-            自動制御指令 パターンノッチ = パターン.出力ノッチ(状態);
-            ノッチ = std::min(ノッチ, パターンノッチ);
+    void 制限グラフ::評価対象追加(
+        パターン一括評価 &評価, const 共通状態 &状態,
+        パターン一括評価::出所型 出所) const
+    {
+        m 評価終点 = 状態.現在位置() + 評価距離(状態);
+
+        for (auto i = 未通過先頭(); i != _区間リスト.end(); ++i) {
+            if (i->以降最小減速目標地点 > 評価終点) {
+                // これ以降の区間はどれも最大力行ノッチを返すので計算しない
+                評価.上限追加(状態.最大力行ノッチ(), 出所);
+                break;
+            }
+
+            評価.追加(i->目標パターン(状態), 出所);
         }
+    }
 
+    自動制御指令 制限グラフ::全区間出力ノッチ(
+        const 減速パターン::共通入力 &入力) const
+    {
+        自動制御指令 ノッチ = 力行ノッチ{std::numeric_limits<unsigned>::max()};
+        for (auto i = 未通過先頭(); i != _区間リスト.end(); ++i) {
+            ノッチ = std::min(ノッチ, i->出力ノッチ(入力));
+        }
         return ノッチ;
     }
 
@@ -177,13 +350,46 @@ namespace autopilot
         減速目標地点 = std::min(減速目標地点, 新しい減速目標地点);
     }
 
-    減速パターン 制限グラフ::制限区間::目標パターン(mps2 初期減速度) const
+    const 減速パターン &制限グラフ::制限区間::目標パターン(
+        const 共通状態 &状態) const
     {
+        mps2 勾配影響 = std::max(状態.進路勾配加速度(始点), 0.0_mps2);
+        mps2 初期減速度 = 状態.目安減速度() - 勾配影響;
+
         constexpr mps 速度マージン = 0.5_kmph;
         mps 目標速度 = std::max(速度 - 速度マージン, 0.0_mps);
         mps2 最終減速度 = 目標速度 == 0.0_mps ?
             減速パターン::停止最終減速度 : 減速パターン::標準最終減速度;
-        return 減速パターン{減速目標地点, 目標速度, 初期減速度, 最終減速度};
+
+        // パターンの値が前回と同じなら終盤の計算結果がそのまま使われる
+        _パターン.目標位置 = 減速目標地点;
+        _パターン.目標速度 = 目標速度;
+        _パターン.初期減速度 = 初期減速度;
+        _パターン.最終減速度 = 最終減速度;
+        return _パターン;
+    }
+
+    自動制御指令 制限グラフ::制限区間::出力ノッチ(
+        const 減速パターン::共通入力 &入力) const
+    {
+        return 目標パターン(入力.状態).出力ノッチ(入力);
+    }
+
+    void 制限グラフ::状態保存(状態書込 &書込) const
+    {
+        書込.一覧(_区間リスト);
+        書込.値(_通過済区間数);
+        書込.値(_変更回数);
+    }
+
+    void 制限グラフ::状態復元(状態読込 &読込)
+    {
+        読込.一覧(_区間リスト);
+        読込.値(_通過済区間数);
+        読込.値(_変更回数);
+        if (_通過済区間数 > _区間リスト.size()) {
+            throw std::runtime_error("invalid 制限グラフ snapshot");
+        }
     }
 
 }
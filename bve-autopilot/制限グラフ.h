@@ -18,9 +18,12 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
-#include <map>
+#include <cstddef>
+#include <vector>
 #include "制御指令.h"
+#include "パターン一括評価.h"
 #include "区間.h"
+#include "減速パターン.h"
 #include "物理量.h"
 
 #pragma warning(push)
@@ -30,6 +33,8 @@ namespace autopilot
 {
 
     class 共通状態;
+    class 状態書込;
+    class 状態読込;
 
     class 制限グラフ
     {
@@ -49,12 +54,66 @@ namespace autopilot
         mps 現在常用パターン速度(const 共通状態 &状態) const;
 
         自動制御指令 出力ノッチ(const 共通状態 &状態) const;
+        /// 出力ノッチ の計算に必要なパターンを追加します。
+        void 評価対象追加(
+            パターン一括評価 &評価, const 共通状態 &状態,
+            パターン一括評価::出所型 出所) const;
+
+        /// 制限区間追加 を途中まで行った時点のグラフの状態
+        struct 記録点
+        {
+            std::size_t 区間数;
+            std::size_t 通過済区間数;
+            m 末尾減速目標地点;
+            unsigned 変更回数;
+        };
+
+        記録点 現在記録点() const;
+        /// 記録点以降の制限区間追加をなかったことにする。
+        /// 記録点以降に末尾以外の区間を変更していて戻せない時は
+        /// 何もせず false を返す。
+        bool 記録点まで戻す(const 記録点 &戻り先);
+
+        // 区間の内容が全て同じかどうか (検証用)
+        bool 等しい(const 制限グラフ &比較対象) const;
+
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
 
     private:
-        struct 制限区間;
+        struct 制限区間
+        {
+            m 始点;
+            m 減速目標地点;
+            mps 速度;
+            // この区間以降の全区間の減速目標地点の最小値 (NaN を含む時は NaN)
+            m 以降最小減速目標地点;
+            // 前回の 目標パターン の結果 (終盤の計算結果を使い回すため)
+            mutable 減速パターン _パターン = {m::無限大(), {}, {}};
 
-        // 区間の始点からその区間のデータへの写像
-        std::map<m, 制限区間> _区間リスト;
+            void 減速目標地点を再設定(m 新しい減速目標地点);
+
+            const 減速パターン &目標パターン(const 共通状態 &状態) const;
+            自動制御指令 出力ノッチ(const 減速パターン::共通入力 &入力) const;
+        };
+        using 区間リスト型 = std::vector<制限区間>;
+
+        // 始点の昇順に並べた区間のデータ。
+        // 先頭から _通過済区間数 個は通過済みで、もう使わない。
+        区間リスト型 _区間リスト;
+        std::size_t _通過済区間数 = 0;
+        // 出力ノッチ の計算に使う (メモリを使い回すため)
+        mutable パターン一括評価 _評価;
+        // 末尾の区間の減速目標地点以外を変更する度に増やす
+        unsigned _変更回数 = 0;
+
+        区間リスト型::const_iterator 未通過先頭() const {
+            return _区間リスト.begin() + _通過済区間数;
+        }
+        void 以降最小減速目標地点更新(区間リスト型::iterator i);
+        // 評価距離による省略をせずに計算した出力ノッチ (検証用)
+        自動制御指令 全区間出力ノッチ(
+            const 減速パターン::共通入力 &入力) const;
     };
 
 }
@@ -20,45 +20,193 @@
 #include "stdafx.h"
 #include "加速度計.h"
 #include <algorithm>
+#include <cmath>
+#include "状態保存.h"
+
+#pragma warning(disable:4819)
 
 namespace autopilot
 {
 
-    加速度計::加速度計() : _記録(), _加速度{}, _加加速度{}
+    加速度計::加速度計() :
+        _記録(既定窓長), _加速度{}, _加加速度{}, _速度雑音{mps::quiet_NaN()}
+    {
+    }
+
+    void 加速度計::設定(推定方式 方式, std::size_t 窓長)
     {
+        _方式 = 方式;
+        _記録.assign(std::max<std::size_t>(窓長, 1), 観測{});
+        リセット();
     }
 
     void 加速度計::リセット()
     {
-        for (観測& 記録 : _記録) {
-            記録 = {};
-        }
+        // 差分平均 では最初は時刻 0 で止まっていた記録があるものとする
+        std::fill(_記録.begin(), _記録.end(), 観測{});
+        _次 = 0;
+        _個数 = 0;
         _加速度 = {};
         _加加速度 = {};
+        _速度雑音 = mps::quiet_NaN();
+        _基準 = {};
+        _再計算まで = 0;
+        _x和 = _y和 = _xx和 = _xy和 = _yy和 = 0;
     }
 
     void 加速度計::経過(観測 今回)
     {
         // 加加速度計算用に取っておく
         mps2 旧加速度 = _加速度;
-        s 旧時刻 = _記録[記録数 - 1]._時刻;
+        s 旧時刻 = _記録[(_次 + _記録.size() - 1) % _記録.size()]._時刻;
+
+        switch (_方式) {
+        case 推定方式::差分平均:
+            差分平均経過(今回);
+            break;
+        case 推定方式::最小二乗:
+            最小二乗経過(今回);
+            break;
+        }
+
+        _加加速度 =
+            (_加速度 - 旧加速度) / std::max(今回._時刻 - 旧時刻, 0.0_s);
+    }
 
-        // 過去"記録数"回分の記録との速度差から算出した加速度の平均を求める
+    void 加速度計::差分平均経過(観測 今回)
+    {
+        // 過去"窓長"回分の記録との速度差から算出した加速度の平均を求める
         mps2 加速度和 = 0.0_mps2;
 
-        for (unsigned i = 0; i < 記録数; i++) {
-            s 時刻差 = 今回._時刻 - _記録[i]._時刻;
-            mps 速度差 = 今回._速度 - _記録[i]._速度;
+        std::size_t 窓長 = _記録.size();
+        for (std::size_t i = 0, j = _次; i < 窓長; i++) {
+            s 時刻差 = 今回._時刻 - _記録[j]._時刻;
+            mps 速度差 = 今回._速度 - _記録[j]._速度;
             if (時刻差 > 0.0_s) {
                 加速度和 += 速度差 / 時刻差;
             }
+            j = j + 1 < 窓長 ? j + 1 : 0;
+        }
+
+        // 一番古い記録を今回の記録で上書きする
+        _記録[_次] = 今回;
+        _次 = _次 + 1 < 窓長 ? _次 + 1 : 0;
+
+        _加速度 = 加速度和 / static_cast<double>(窓長);
+    }
 
-            _記録[i] = i + 1 < 記録数 ? _記録[i + 1] : 今回;
+    void 加速度計::最小二乗経過(観測 今回)
+    {
+        std::size_t 窓長 = _記録.size();
+        std::size_t 最新 = (_次 + 窓長 - 1) % 窓長;
+        if (_個数 > 0 && 今回._時刻 < _記録[最新]._時刻) {
+            _個数 = 0; // 時刻が戻ったら前の記録は使わない
         }
 
-        _加速度 = 加速度和 / static_cast<double>(記録数);
-        _加加速度 =
-            (_加速度 - 旧加速度) / std::max(今回._時刻 - 旧時刻, 0.0_s);
+        if (_個数 == 窓長) {
+            // 一番古い記録を和から除く
+            const 観測 &最古 = _記録[_次];
+            double x = (最古._時刻 - _基準._時刻).value;
+            double y = (最古._速度 - _基準._速度).value;
+            _x和 -= x;
+            _y和 -= y;
+            _xx和 -= x * x;
+            _xy和 -= x * y;
+            _yy和 -= y * y;
+            _個数--;
+        }
+        _記録[_次] = 今回;
+        _次 = _次 + 1 < 窓長 ? _次 + 1 : 0;
+        _個数++;
+
+        if (_個数 == 1 || _再計算まで == 0) {
+            和を再計算();
+        }
+        else {
+            double x = (今回._時刻 - _基準._時刻).value;
+            double y = (今回._速度 - _基準._速度).value;
+            _x和 += x;
+            _y和 += y;
+            _xx和 += x * x;
+            _xy和 += x * y;
+            _yy和 += y * y;
+            _再計算まで--;
+        }
+
+        double n = static_cast<double>(_個数);
+        double xx偏差 = _xx和 - _x和 * _x和 / n;
+        double xy偏差 = _xy和 - _x和 * _y和 / n;
+        double yy偏差 = _yy和 - _y和 * _y和 / n;
+        if (_個数 < 2 || !(xx偏差 > 0)) {
+            _加速度 = {};
+            _速度雑音 = mps::quiet_NaN();
+            return;
+        }
+
+        _加速度 = static_cast<mps2>(xy偏差 / xx偏差);
+        if (_個数 > 2) {
+            double 残差平方和 =
+                std::max(yy偏差 - xy偏差 * xy偏差 / xx偏差, 0.0);
+            _速度雑音 = static_cast<mps>(std::sqrt(残差平方和 / (n - 2)));
+        }
+        else {
+            _速度雑音 = mps::quiet_NaN();
+        }
+    }
+
+    void 加速度計::和を再計算()
+    {
+        std::size_t 窓長 = _記録.size();
+        std::size_t 最古 = (_次 + 窓長 - _個数) % 窓長;
+        _基準 = _記録[最古];
+        _x和 = _y和 = _xx和 = _xy和 = _yy和 = 0;
+        for (std::size_t i = 0, j = 最古; i < _個数; i++) {
+            double x = (_記録[j]._時刻 - _基準._時刻).value;
+            double y = (_記録[j]._速度 - _基準._速度).value;
+            _x和 += x;
+            _y和 += y;
+            _xx和 += x * x;
+            _xy和 += x * y;
+            _yy和 += y * y;
+            j = j + 1 < 窓長 ? j + 1 : 0;
+        }
+        // 窓の長さ分の記録を足したら基準を取り直して誤差をため込まない
+        _再計算まで = 窓長;
+    }
+
+    void 加速度計::状態保存(状態書込 &書込) const
+    {
+        書込.値(_方式);
+        書込.一覧(_記録);
+        書込.値(_次);
+        書込.値(_個数);
+        書込.値(_加速度);
+        書込.値(_加加速度);
+        書込.値(_速度雑音);
+        書込.値(_基準);
+        書込.値(_再計算まで);
+        for (double 和 : {_x和, _y和, _xx和, _xy和, _yy和}) {
+            書込.値(和);
+        }
+    }
+
+    void 加速度計::状態復元(状態読込 &読込)
+    {
+        読込.値(_方式);
+        読込.一覧(_記録);
+        読込.値(_次);
+        読込.値(_個数);
+        if (_記録.empty() || _次 >= _記録.size() || _個数 > _記録.size()) {
+            throw std::runtime_error("invalid 加速度計 snapshot");
+        }
+        読込.値(_加速度);
+        読込.値(_加加速度);
+        読込.値(_速度雑音);
+        読込.値(_基準);
+        読込.値(_再計算まで);
+        for (double *和 : {&_x和, &_y和, &_xx和, &_xy和, &_yy和}) {
+            読込.値(*和);
+        }
     }
 
 }
@@ -18,11 +18,19 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
+#include <cstddef>
+#include <vector>
 #include "物理量.h"
 
+#pragma warning(push)
+#pragma warning(disable:4819)
+
 namespace autopilot
 {
 
+    class 状態書込;
+    class 状態読込;
+
     class 加速度計
     {
     public:
@@ -31,19 +39,55 @@ namespace autopilot
             s _時刻;
         };
 
+        enum class 推定方式 {
+            /// 窓内の各記録との速度差から求めた加速度の平均。
+            /// 一フレームの計算量は窓の長さに比例する
+            差分平均,
+            /// 窓内の記録に最小二乗法で当てはめた直線の傾き。
+            /// 和を持ち回るので一フレームの計算量は窓の長さによらない
+            最小二乗,
+        };
+
+        constexpr static std::size_t 既定窓長 = 3;
+
         加速度計();
 
+        /// 推定方式と何フレーム分の記録を使うかを変える。
+        /// 記録は消えるので リセット の前に呼ぶ
+        void 設定(推定方式 方式, std::size_t 窓長);
         void リセット();
         void 経過(観測 データ);
 
         mps2 加速度() const { return _加速度; }
         mps3 加加速度() const { return _加加速度; }
+        /// 当てはめた直線からの速度のずれの標準偏差。
+        /// 最小二乗 で記録が 3 個以上ある時だけ求まり、それ以外は NaN
+        mps 速度雑音() const { return _速度雑音; }
+
+        /// 推定方式と窓長も記録ごと保存・復元する
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
 
     private:
-        constexpr static unsigned 記録数 = 3;
-        観測 _記録[記録数];
+        推定方式 _方式 = 推定方式::差分平均;
+        // 古い順に _次 から始まる環状の配列
+        std::vector<観測> _記録;
+        std::size_t _次 = 0, _個数 = 0;
         mps2 _加速度;
         mps3 _加加速度;
+        mps _速度雑音;
+
+        // 最小二乗 で使う和。桁落ちを防ぐため時刻と速度は _基準 からの
+        // 差で足し、窓の長さ分の記録を足すごとに基準を取り直す
+        観測 _基準 = {};
+        std::size_t _再計算まで = 0;
+        double _x和 = 0, _y和 = 0, _xx和 = 0, _xy和 = 0, _yy和 = 0;
+
+        void 差分平均経過(観測 今回);
+        void 最小二乗経過(観測 今回);
+        void 和を再計算();
     };
 
 }
+
+#pragma warning(pop)
@@ -25,6 +25,7 @@
 #include <iterator>
 #include <utility>
 #include "区間.h"
+#include "状態保存.h"
 
 #pragma warning(disable:4819)
 
@@ -40,53 +41,84 @@ namespace autopilot
 
     struct 勾配グラフ::勾配区間
     {
+        m 始点;
         double 勾配;
         mps2 影響加速度;
+        // 先頭の区間の始点からこの区間の始点までの影響加速度の積分
+        m2ps2 始点までの積分;
 
-        勾配区間(double 勾配) :
-            勾配{勾配}, 影響加速度{-0.75 * 重力加速度 * 勾配} { }
+        勾配区間(m 始点, double 勾配) :
+            始点{始点}, 勾配{勾配}, 影響加速度{-0.75 * 重力加速度 * 勾配},
+            始点までの積分{} { }
         // 本当は tan を sin に変換すべきだがほとんど違わないので無視する
 
     };
 
+    namespace
+    {
+
+        template<typename 区間型>
+        bool 始点が前(const 区間型 &区間, m 位置) {
+            return 区間.始点 < 位置;
+        }
+
+        template<typename 区間型>
+        bool 始点が後(m 位置, const 区間型 &区間) {
+            return 位置 < 区間.始点;
+        }
+
+    }
+
     勾配グラフ::勾配グラフ() = default;
+    勾配グラフ::勾配グラフ(const 勾配グラフ &) = default;
     勾配グラフ::~勾配グラフ() = default;
+    勾配グラフ &勾配グラフ::operator=(const 勾配グラフ &) = default;
 
     void 勾配グラフ::消去()
     {
         _区間リスト.clear();
+        _通過済区間数 = 0;
+        _最大勾配加速度 = {};
     }
 
     void 勾配グラフ::勾配区間追加(m 始点, double 勾配)
     {
-        // データを追加するだけなら
-        // _区間リスト.insert_or_assign(始点, 勾配区間{勾配});
-        // だけでもよいのだが、無駄に多くのデータを追加しないように
+        // データを追加するだけなら始点の位置に挿入するだけでもよいのだが、
+        // 無駄に多くのデータを追加しないように
         // 以下の長々としたコードで最適化する。
 
-        auto i = _区間リスト.lower_bound(始点);
+        _最大勾配加速度 =
+            std::max(_最大勾配加速度, 勾配区間{始点, 勾配}.影響加速度);
+
+        // 通過済みの区間はここでまとめて消す
+        _区間リスト.erase(
+            _区間リスト.begin(), _区間リスト.begin() + _通過済区間数);
+        _通過済区間数 = 0;
+
+        auto i = std::lower_bound(_区間リスト.begin(), _区間リスト.end(),
+            始点, 始点が前<勾配区間>);
 
         if (i != _区間リスト.end()) {
-            if (勾配 == i->second.勾配) {
+            if (勾配 == i->勾配) {
                 // 既に同じ勾配の区間があるなら区間を追加しない
-                auto n = _区間リスト.extract(i++);
-                assert(始点 <= n.key());
-                n.key() = 始点;
-                _区間リスト.insert(i, std::move(n));
+                assert(始点 <= i->始点);
+                i->始点 = 始点;
+                積分更新(i);
                 return;
             }
 
-            if (始点 == i->first) {
+            if (始点 == i->始点) {
                 // 既に同じ位置に区間があるなら上書きする
-                i->second = 勾配区間{勾配};
+                *i = 勾配区間{始点, 勾配};
+                積分更新(i);
                 return;
             }
         }
 
         if (i != _区間リスト.begin()) {
             auto j = std::prev(i);
-            assert(j->first < 始点);
-            if (勾配 == j->second.勾配) {
+            assert(j->始点 < 始点);
+            if (勾配 == j->勾配) {
                 // 既に同じ勾配の区間があるなら区間を追加しない
                 return;
             }
@@ -96,33 +128,60 @@ namespace autopilot
             return;
         }
 
-        auto j = _区間リスト.try_emplace(i, 始点, 勾配);
-        assert(std::next(j) == i);
+        i = _区間リスト.insert(i, 勾配区間{始点, 勾配});
+        積分更新(i);
+    }
+
+    void 勾配グラフ::積分更新(区間リスト型::iterator i)
+    {
+        for (; i != _区間リスト.end(); ++i) {
+            if (i == _区間リスト.begin()) {
+                i->始点までの積分 = {};
+                continue;
+            }
+            auto j = std::prev(i);
+            i->始点までの積分 = j->始点までの積分 +
+                (i->始点 - j->始点) * j->影響加速度;
+        }
     }
 
     void 勾配グラフ::通過(m 位置)
     {
-        if (_区間リスト.empty()) {
+        std::size_t 区間数 = _区間リスト.size();
+        if (_通過済区間数 >= 区間数) {
             return;
         }
 
-        // 通過済みの区間を消す
-        auto i = _区間リスト.begin();
-        while (true) {
-            auto j = std::next(i);
-            if (j == _区間リスト.end() || j->first > 位置) {
-                break;
-            }
-            i = j;
+        // 通過済みの区間を飛ばす
+        while (_通過済区間数 + 1 < 区間数 &&
+            _区間リスト[_通過済区間数 + 1].始点 <= 位置)
+        {
+            _通過済区間数++;
         }
-        i = _区間リスト.erase(_区間リスト.begin(), i);
-        assert(!_区間リスト.empty());
-        assert(i == _区間リスト.begin());
 
         // 傾きが 0 の区間は未通過でも消す
-        if (i->second.勾配 == 0.0) {
-            _区間リスト.erase(i);
+        if (_区間リスト[_通過済区間数].勾配 == 0.0) {
+            _通過済区間数++;
+        }
+    }
+
+    勾配グラフ::区間リスト型::const_iterator 勾配グラフ::未通過先頭() const
+    {
+        return _区間リスト.begin() + _通過済区間数;
+    }
+
+    m2ps2 勾配グラフ::積分(m 位置) const
+    {
+        // 位置を含む区間 (最初の区間より前なら影響なし)
+        auto 先頭 = 未通過先頭();
+        auto i = std::upper_bound(先頭, _区間リスト.end(),
+            位置, 始点が後<勾配区間>);
+        if (i == 先頭) {
+            return 先頭 == _区間リスト.end() ?
+                m2ps2{} : 先頭->始点までの積分;
         }
+        --i;
+        return i->始点までの積分 + (位置 - i->始点) * i->影響加速度;
     }
 
     mps2 勾配グラフ::勾配加速度(区間 対象範囲) const
@@ -131,14 +190,25 @@ namespace autopilot
         if (!(全体長さ > 0.0_m)) {
             return 0.0_mps2;
         }
+        if (!isfinite(全体長さ)) {
+            // 無限に長い範囲は滅多にないので区間ごとに計算する
+            return 全区間勾配加速度(対象範囲);
+        }
+
+        // 区間の重なりを一つずつ調べる代わりに積分の差を取る
+        return (積分(対象範囲.終点) - 積分(対象範囲.始点)) / 全体長さ;
+    }
 
+    mps2 勾配グラフ::全区間勾配加速度(区間 対象範囲) const
+    {
+        m 全体長さ = 対象範囲.長さ();
         mps2 加速度 = 0.0_mps2;
         auto 終点 = m::無限大();
-        for (auto i = _区間リスト.rbegin();
-            i != _区間リスト.rend();
-            終点 = i++->first)
+        for (auto i = _区間リスト.crbegin();
+            i.base() != 未通過先頭();
+            終点 = i++->始点)
         {
-            auto 影響区間 = 重なり({i->first, 終点}, 対象範囲);
+            auto 影響区間 = 重なり({i->始点, 終点}, 対象範囲);
             m 影響長さ = 影響区間.長さ();
             if (!(影響長さ > 0.0_m)) {
                 continue;
@@ -148,9 +218,40 @@ namespace autopilot
             if (std::isnan(影響割合)) {
                 影響割合 = 1;
             }
-            加速度 += i->second.影響加速度 * 影響割合;
+            加速度 += i->影響加速度 * 影響割合;
         }
         return 加速度;
     }
 
+    void 勾配グラフ::状態保存(状態書込 &書込) const
+    {
+        書込.個数(_区間リスト.size());
+        for (const 勾配区間 &区間 : _区間リスト) {
+            書込.値(区間.始点);
+            書込.値(区間.勾配);
+            書込.値(区間.始点までの積分);
+        }
+        書込.値(_通過済区間数);
+        書込.値(_最大勾配加速度);
+    }
+
+    void 勾配グラフ::状態復元(状態読込 &読込)
+    {
+        std::size_t 個数 =
+            読込.個数(sizeof(m) + sizeof(double) + sizeof(m2ps2));
+        _区間リスト.clear();
+        for (std::size_t i = 0; i < 個数; i++) {
+            m 始点;
+            double 勾配;
+            読込.値(始点);
+            読込.値(勾配);
+            読込.値(_区間リスト.emplace_back(始点, 勾配).始点までの積分);
+        }
+        読込.値(_通過済区間数);
+        読込.値(_最大勾配加速度);
+        if (_通過済区間数 > _区間リスト.size()) {
+            throw std::runtime_error("invalid 勾配グラフ snapshot");
+        }
+    }
+
 }
@@ -18,7 +18,8 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
-#include <map>
+#include <cstddef>
+#include <vector>
 #include "区間.h"
 #include "物理量.h"
 
@@ -28,11 +29,17 @@
 namespace autopilot
 {
 
+    class 状態書込;
+    class 状態読込;
+
     class 勾配グラフ
     {
     public:
         勾配グラフ();
+        勾配グラフ(const 勾配グラフ &元);
         ~勾配グラフ();
+        /// 区間の数が前に写した時より増えていなければメモリを確保しない
+        勾配グラフ &operator=(const 勾配グラフ &元);
 
         void 消去();
         void 勾配区間追加(m 始点, double 勾配);
@@ -43,11 +50,29 @@ namespace autopilot
         // 下り勾配では正の加速度がかかるので正の値を返します。
         mps2 勾配加速度(区間 対象範囲) const;
 
+        // 勾配加速度 がどの範囲に対しても超えない値を返します。
+        // (通過済みの区間も含めて、これまでに追加した区間の最大値)
+        mps2 最大勾配加速度() const { return _最大勾配加速度; }
+
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+
     private:
         struct 勾配区間;
+        using 区間リスト型 = std::vector<勾配区間>;
+
+        // 始点の昇順に並べた区間のデータ。
+        // 先頭から _通過済区間数 個は通過済みで、もう使わない。
+        区間リスト型 _区間リスト;
+        std::size_t _通過済区間数 = 0;
+        mps2 _最大勾配加速度 = {};
 
-        // 区間の始点からその区間のデータへの写像
-        std::map<m, 勾配区間> _区間リスト;
+        区間リスト型::const_iterator 未通過先頭() const;
+        // 先頭の区間の始点から指定した位置までの影響加速度の積分
+        m2ps2 積分(m 位置) const;
+        // i 以降の区間の 始点までの積分 を計算し直す
+        void 積分更新(区間リスト型::iterator i);
+        mps2 全区間勾配加速度(区間 対象範囲) const;
     };
 
 }
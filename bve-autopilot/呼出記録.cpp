@@ -0,0 +1,242 @@
+// 呼出記録.cpp : BVE 本体からプラグインへの呼出しを記録・再生します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+#include "呼出記録.h"
+#include <cstring>
+#include <stdexcept>
+
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    namespace
+    {
+
+        constexpr char 識別子[8] = {'B', 'V', 'E', 'A', 'P', 'T', 'R', 0};
+        constexpr std::uint32_t 形式版 = 1;
+
+        void 書く(std::ostream &s, std::uint32_t v)
+        {
+            char b[4];
+            for (int i = 0; i < 4; i++) {
+                b[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+            }
+            s.write(b, sizeof b);
+        }
+
+        void 書く(std::ostream &s, std::uint64_t v)
+        {
+            char b[8];
+            for (int i = 0; i < 8; i++) {
+                b[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+            }
+            s.write(b, sizeof b);
+        }
+
+        void 書く(std::ostream &s, int v)
+        {
+            書く(s, static_cast<std::uint32_t>(v));
+        }
+
+        void 書く(std::ostream &s, float v)
+        {
+            std::uint32_t u;
+            std::memcpy(&u, &v, sizeof u);
+            書く(s, u);
+        }
+
+        void 書く(std::ostream &s, double v)
+        {
+            std::uint64_t u;
+            std::memcpy(&u, &v, sizeof u);
+            書く(s, u);
+        }
+
+        [[noreturn]] void 途切れた()
+        {
+            throw std::runtime_error("truncated trace record");
+        }
+
+        void 読む(std::istream &s, std::uint32_t &v)
+        {
+            unsigned char b[4];
+            if (!s.read(reinterpret_cast<char *>(b), sizeof b)) {
+                途切れた();
+            }
+            v = 0;
+            for (int i = 0; i < 4; i++) {
+                v |= static_cast<std::uint32_t>(b[i]) << (8 * i);
+            }
+        }
+
+        void 読む(std::istream &s, std::uint64_t &v)
+        {
+            unsigned char b[8];
+            if (!s.read(reinterpret_cast<char *>(b), sizeof b)) {
+                途切れた();
+            }
+            v = 0;
+            for (int i = 0; i < 8; i++) {
+                v |= static_cast<std::uint64_t>(b[i]) << (8 * i);
+            }
+        }
+
+        void 読む(std::istream &s, int &v)
+        {
+            std::uint32_t u;
+            読む(s, u);
+            v = static_cast<int>(u);
+        }
+
+        void 読む(std::istream &s, float &v)
+        {
+            std::uint32_t u;
+            読む(s, u);
+            std::memcpy(&v, &u, sizeof v);
+        }
+
+        void 読む(std::istream &s, double &v)
+        {
+            std::uint64_t u;
+            読む(s, u);
+            std::memcpy(&v, &u, sizeof v);
+        }
+
+    }
+
+    呼出記録書込::呼出記録書込(std::ostream &出力先) : _出力先{出力先}
+    {
+        _出力先.write(識別子, sizeof 識別子);
+        書く(_出力先, 形式版);
+    }
+
+    void 呼出記録書込::書込(const 呼出 &呼出)
+    {
+        std::ostream &s = _出力先;
+        s.put(static_cast<char>(呼出.種別));
+
+        switch (呼出.種別) {
+        case 呼出種別::Load:
+        case 呼出種別::Dispose:
+        case 呼出種別::DoorOpen:
+        case 呼出種別::DoorClose:
+            break;
+        case 呼出種別::SetVehicleSpec:
+            書く(s, 呼出.車両仕様.BrakeNotches);
+            書く(s, 呼出.車両仕様.PowerNotches);
+            書く(s, 呼出.車両仕様.AtsNotch);
+            書く(s, 呼出.車両仕様.B67Notch);
+            書く(s, 呼出.車両仕様.Cars);
+            break;
+        case 呼出種別::Elapse:
+            書く(s, 呼出.車両状態.Location);
+            書く(s, 呼出.車両状態.Speed);
+            書く(s, 呼出.車両状態.Time);
+            書く(s, 呼出.車両状態.BcPressure);
+            書く(s, 呼出.車両状態.MrPressure);
+            書く(s, 呼出.車両状態.ErPressure);
+            書く(s, 呼出.車両状態.BpPressure);
+            書く(s, 呼出.車両状態.SapPressure);
+            書く(s, 呼出.車両状態.Current);
+            break;
+        case 呼出種別::SetBeaconData:
+            書く(s, 呼出.地上子.Type);
+            書く(s, 呼出.地上子.Signal);
+            書く(s, 呼出.地上子.Distance);
+            書く(s, 呼出.地上子.Optional);
+            break;
+        default:
+            書く(s, 呼出.引数);
+            break;
+        }
+    }
+
+    呼出記録読込::呼出記録読込(std::istream &入力元) : _入力元{入力元}
+    {
+        char 読んだ識別子[sizeof 識別子];
+        std::uint32_t 版;
+        if (!_入力元.read(読んだ識別子, sizeof 読んだ識別子) ||
+            std::memcmp(読んだ識別子, 識別子, sizeof 識別子) != 0)
+        {
+            throw std::runtime_error("not a trace file");
+        }
+        読む(_入力元, 版);
+        if (版 != 形式版) {
+            throw std::runtime_error("unsupported trace version");
+        }
+    }
+
+    bool 呼出記録読込::読込(呼出 &呼出)
+    {
+        std::istream &s = _入力元;
+        auto 種別 = s.get();
+        if (種別 == std::istream::traits_type::eof()) {
+            return false;
+        }
+
+        呼出.種別 = static_cast<呼出種別>(種別);
+        switch (呼出.種別) {
+        case 呼出種別::Load:
+        case 呼出種別::Dispose:
+        case 呼出種別::DoorOpen:
+        case 呼出種別::DoorClose:
+            break;
+        case 呼出種別::SetVehicleSpec:
+            読む(s, 呼出.車両仕様.BrakeNotches);
+            読む(s, 呼出.車両仕様.PowerNotches);
+            読む(s, 呼出.車両仕様.AtsNotch);
+            読む(s, 呼出.車両仕様.B67Notch);
+            読む(s, 呼出.車両仕様.Cars);
+            break;
+        case 呼出種別::Elapse:
+            読む(s, 呼出.車両状態.Location);
+            読む(s, 呼出.車両状態.Speed);
+            読む(s, 呼出.車両状態.Time);
+            読む(s, 呼出.車両状態.BcPressure);
+            読む(s, 呼出.車両状態.MrPressure);
+            読む(s, 呼出.車両状態.ErPressure);
+            読む(s, 呼出.車両状態.BpPressure);
+            読む(s, 呼出.車両状態.SapPressure);
+            読む(s, 呼出.車両状態.Current);
+            break;
+        case 呼出種別::SetBeaconData:
+            読む(s, 呼出.地上子.Type);
+            読む(s, 呼出.地上子.Signal);
+            読む(s, 呼出.地上子.Distance);
+            読む(s, 呼出.地上子.Optional);
+            break;
+        case 呼出種別::Initialize:
+        case 呼出種別::SetPower:
+        case 呼出種別::SetBrake:
+        case 呼出種別::SetReverser:
+        case 呼出種別::KeyDown:
+        case 呼出種別::KeyUp:
+        case 呼出種別::HornBlow:
+        case 呼出種別::SetSignal:
+            読む(s, 呼出.引数);
+            break;
+        default:
+            throw std::runtime_error("unknown trace record type");
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,92 @@
+// 呼出記録.h : BVE 本体からプラグインへの呼出しを記録・再生します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#pragma warning(push)
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    /// 記録されたエクスポート関数の種類
+    enum class 呼出種別 : std::uint8_t
+    {
+        Load = 1,
+        Dispose,
+        SetVehicleSpec,
+        Initialize,
+        Elapse,
+        SetPower,
+        SetBrake,
+        SetReverser,
+        KeyDown,
+        KeyUp,
+        HornBlow,
+        DoorOpen,
+        DoorClose,
+        SetSignal,
+        SetBeaconData,
+    };
+
+    /// エクスポート関数の一回分の呼出し。
+    /// 種別に応じて使うメンバーが異なり、使わないメンバーの値は無意味。
+    struct 呼出
+    {
+        呼出種別 種別 = 呼出種別::Load;
+        int 引数 = 0; // Initialize, SetPower など int を一つ取るもの
+        ATS_VEHICLESPEC 車両仕様 = {};
+        ATS_VEHICLESTATE 車両状態 = {};
+        ATS_BEACONDATA 地上子 = {};
+    };
+
+    /// 呼出しを二進形式でストリームに書き出します。
+    /// 各フィールドはリトルエンディアンで一つずつ書くので、
+    /// 構造体のパディングやビルド環境の違いには影響されません。
+    class 呼出記録書込
+    {
+    public:
+        explicit 呼出記録書込(std::ostream &出力先);
+
+        void 書込(const 呼出 &呼出);
+
+    private:
+        std::ostream &_出力先;
+    };
+
+    /// 呼出記録書込 が書き出したものを読み込みます。
+    /// 形式が不正ならば std::runtime_error を投げます。
+    class 呼出記録読込
+    {
+    public:
+        explicit 呼出記録読込(std::istream &入力元);
+
+        /// 次の呼出しを読み込みます。記録の終わりに達したら false を返します。
+        bool 読込(呼出 &呼出);
+
+    private:
+        std::istream &_入力元;
+    };
+
+}
+
+#pragma warning(pop)
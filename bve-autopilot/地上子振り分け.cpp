@@ -0,0 +1,78 @@
+// 地上子振り分け.cpp : 地上子をその種類を処理する部品にだけ渡します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#include "stdafx.h"
+#include "地上子振り分け.h"
+#include <algorithm>
+#include <iterator>
+
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    namespace
+    {
+
+        struct 種類比較
+        {
+            template<typename T>
+            constexpr bool operator()(const T &a, int b) const {
+                return a.種類 < b;
+            }
+            template<typename T>
+            constexpr bool operator()(int a, const T &b) const {
+                return a < b.種類;
+            }
+        };
+
+    }
+
+    地上子振り分け::地上子振り分け() = default;
+    地上子振り分け::~地上子振り分け() = default;
+
+    void 地上子振り分け::登録(
+        std::initializer_list<int> 種類一覧, 処理関数 処理, void *対象)
+    {
+        for (int 種類 : 種類一覧) {
+            // 同じ種類の最後に入れて登録順を保つ
+            auto i = std::upper_bound(
+                _一覧.begin(), _一覧.end(), 種類, 種類比較());
+            _一覧.insert(i, 項目{種類, 処理, 対象});
+        }
+    }
+
+    void 地上子振り分け::実行(
+        const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態) const
+    {
+        auto [i, j] = std::equal_range(
+            _一覧.begin(), _一覧.end(), 地上子.Type, 種類比較());
+        for (; i != j; ++i) {
+            i->処理(i->対象, 地上子, 直前位置, 状態);
+        }
+    }
+
+    std::size_t 地上子振り分け::処理数(int 種類) const
+    {
+        auto [i, j] = std::equal_range(
+            _一覧.begin(), _一覧.end(), 種類, 種類比較());
+        return static_cast<std::size_t>(std::distance(i, j));
+    }
+
+}
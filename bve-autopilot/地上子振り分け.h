@@ -0,0 +1,82 @@
+// 地上子振り分け.h : 地上子をその種類を処理する部品にだけ渡します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+#include "物理量.h"
+
+#pragma warning(push)
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    class 共通状態;
+
+    /// 地上子の種類ごとにそれを処理する部品の関数を登録しておく表です。
+    /// 互換モードごとに一つずつ作っておき、関係のない部品や互換モードの
+    /// 違う地上子の処理を呼ばずに済ませます。
+    class 地上子振り分け
+    {
+    public:
+        using 処理関数 = void (*)(
+            void *対象, const ATS_BEACONDATA &地上子, m 直前位置,
+            const 共通状態 &状態);
+
+        地上子振り分け();
+        ~地上子振り分け();
+
+        void 消去() { _一覧.clear(); }
+        /// 同じ種類の地上子を処理する関数は登録した順に呼ぶ
+        void 登録(std::initializer_list<int> 種類一覧, 処理関数 処理, void *対象);
+        /// 対象.*処理(地上子, 直前位置, 状態) を呼ぶように登録する
+        template<auto 処理, typename T>
+        void 登録(std::initializer_list<int> 種類一覧, T &対象)
+        {
+            登録(種類一覧, [](
+                void *対象, const ATS_BEACONDATA &地上子, m 直前位置,
+                const 共通状態 &状態)
+            {
+                (static_cast<T *>(対象)->*処理)(地上子, 直前位置, 状態);
+            }, &対象);
+        }
+
+        void 実行(
+            const ATS_BEACONDATA &地上子, m 直前位置, const 共通状態 &状態)
+            const;
+
+        /// 指定した種類の地上子を処理する関数の数
+        std::size_t 処理数(int 種類) const;
+
+    private:
+        struct 項目
+        {
+            int 種類;
+            処理関数 処理;
+            void *対象;
+        };
+
+        std::vector<項目> _一覧; // 種類順。同じ種類の中では登録順
+    };
+
+}
+
+#pragma warning(pop)
@@ -23,6 +23,7 @@
 #include <cmath>
 #include <tuple>
 #include "共通状態.h"
+#include "状態保存.h"
 
 namespace autopilot
 {
@@ -68,8 +69,7 @@ namespace autopilot
 
         // 急動作抑制を使わずに出力された制動ノッチも考慮したいので
         // ここで前回出力を取り込む
-        自動制動自然数ノッチ 直前ノッチ =
-            状態.制動().自動ノッチ(状態.前回制動指令());
+        自動制動自然数ノッチ 直前ノッチ = 状態.前回自動制動ノッチ();
         mps2 直前減速度 = 状態.制動().減速度(直前ノッチ);
 
         mps2 実減速度 = std::max(入力減速度, 直前減速度);
@@ -111,4 +111,24 @@ namespace autopilot
         return 自動制動自然数ノッチ{static_cast<unsigned>(新出力ノッチ.value)};
     }
 
+    void 急動作抑制::状態保存(状態書込 &書込) const
+    {
+        書込.値(_最小出力減速度);
+        書込.値(_最大出力減速度);
+        書込.値(_出力ノッチ);
+        書込.値(_最終出力減速度計算時刻);
+        書込.値(_最終力行時刻);
+        書込.値(_最終制動時刻);
+    }
+
+    void 急動作抑制::状態復元(状態読込 &読込)
+    {
+        読込.値(_最小出力減速度);
+        読込.値(_最大出力減速度);
+        読込.値(_出力ノッチ);
+        読込.値(_最終出力減速度計算時刻);
+        読込.値(_最終力行時刻);
+        読込.値(_最終制動時刻);
+    }
+
 }
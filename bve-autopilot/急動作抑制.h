@@ -26,6 +26,8 @@ namespace autopilot
 {
 
     class 共通状態;
+    class 状態書込;
+    class 状態読込;
 
     class 急動作抑制
     {
@@ -35,6 +37,9 @@ namespace autopilot
 
         自動制御指令 出力ノッチ() const { return _出力ノッチ; }
 
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+
     private:
         mps2 _最小出力減速度 = 0.0_mps2, _最大出力減速度 = 0.0_mps2;
         自動制御指令 _出力ノッチ;
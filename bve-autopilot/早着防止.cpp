@@ -20,8 +20,10 @@
 #include "stdafx.h"
 #include "早着防止.h"
 #include <algorithm>
+#include <array>
 #include "共通状態.h"
 #include "減速パターン.h"
+#include "状態保存.h"
 
 #pragma warning(disable:4819)
 
@@ -32,14 +34,28 @@ namespace autopilot
     {
 
         constexpr s バッファ = 0.5_s;
+        // 基準時刻で打ち切る時に丸め誤差で判定が変わらないよう見込む余裕
+        constexpr s 打切余裕 = 0.001_s;
+
+        // 1 m/s から 1.25 倍ずつ 300 km/h 余りまで
+        constexpr std::size_t 基準速度段数 = 20;
+        constexpr std::array<mps, 基準速度段数> 基準速度一覧 = [] {
+            std::array<mps, 基準速度段数> 一覧{};
+            mps 速度 = 1.0_mps;
+            for (mps &v : 一覧) {
+                v = 速度;
+                速度 = 速度 * 1.25;
+            }
+            return 一覧;
+        }();
 
         constexpr s 正午 = static_cast<s>(12 * 60 * 60);
         constexpr s 一日 = static_cast<s>(24 * 60 * 60);
 
-        s 予定時刻(const 走行モデル &予定, const 共通状態 &状態) {
+        s 予定時刻(const 走行モデル &予定, s 現在時刻) {
             s 時刻 = 予定.時刻();
             // 日をまたぐと時刻が戻るので補正する
-            if (時刻 < 正午 && 正午 <= 状態.現在時刻()) {
+            if (時刻 < 正午 && 正午 <= 現在時刻) {
                 時刻 += 一日;
             }
             return 時刻;
@@ -54,10 +70,16 @@ namespace autopilot
 
     void 早着防止::発進(const 共通状態 &状態)
     {
-        // 通過済みの予定を消す
-        _予定表.remove_if([&](const 走行モデル &予定) {
-            return 予定.位置() <= 状態.現在位置() + 5.0_m;
+        // 通過済みの予定を消す (位置順なので先頭から続いている)
+        m 通過済位置 = 状態.現在位置() + 5.0_m;
+        auto 未通過 = std::find_if(_予定表.begin(), _予定表.end(),
+            [&](const 予定 &予定) {
+                return 予定.通過.位置() > 通過済位置;
             });
+        if (未通過 != _予定表.begin()) {
+            _予定表.erase(_予定表.begin(), 未通過);
+            _基準時刻有効 = false;
+        }
     }
 
     void 早着防止::地上子通過(const ATS_BEACONDATA &地上子, m 直前位置)
@@ -72,12 +94,19 @@ namespace autopilot
         }
     }
 
+    void 早着防止::地上子処理登録(地上子振り分け &振り分け)
+    {
+        振り分け.登録({1028, 1029}, [](
+            void *対象, const ATS_BEACONDATA &地上子, m 直前位置,
+            const 共通状態 &)
+        {
+            static_cast<早着防止 *>(対象)->地上子通過(地上子, 直前位置);
+        }, this);
+    }
+
     void 早着防止::経過(const 共通状態 &状態)
     {
-        // 古い予定を消す
-        _予定表.remove_if([&](const 走行モデル &予定) {
-            return 予定時刻(予定, 状態) + バッファ < 状態.現在時刻();
-            });
+        古い予定を削除(状態);
 
         if (加速可(状態)) {
             _出力ノッチ = 状態.最大力行ノッチ();
@@ -101,38 +130,149 @@ namespace autopilot
     {
         m 位置 = 地上子位置 + static_cast<m>(地上子.Optional / 1000);
         mps 速度 = static_cast<kmph>(地上子.Optional % 1000);
-        _予定表.emplace_front(位置, 速度, _次の設定時刻);
+        auto i = std::upper_bound(_予定表.begin(), _予定表.end(), 位置,
+            [](m 位置, const 予定 &予定) { return 位置 < 予定.通過.位置(); });
+        _予定表.insert(i, 予定{走行モデル{位置, 速度, _次の設定時刻},
+            減速パターン{位置, 速度, _予定減速度}});
+        _削除期限 = -s::無限大();
+        _基準時刻有効 = false;
     }
 
-    bool 早着防止::加速可(const 共通状態 &状態) const
+    void 早着防止::古い予定を削除(const 共通状態 &状態)
     {
-        return std::all_of(
-            _予定表.begin(), _予定表.end(),
-            [&](const 走行モデル &予定) {
-                走行モデル 走行 = 状態.現在走行状態();
-
-                // 現在状態から一定時間加速する動きをまずシミュレートする
-                短く力行(走行, 状態.最大力行ノッチ(), 5.0_kmphps, 状態);
-
-                // 減速にかかる時間を計算する
-                減速パターン 減速{予定.位置(), 予定.速度(), 状態.目安減速度()};
-                走行モデル 減速開始 = 減速.パターン到達状態(走行.速度());
-                s 減速時間 = -減速開始.時刻();
-
-                // 減速開始地点まで惰行する時間を計算する
-                走行.指定位置まで走行(減速開始.位置());
-
-                s 到達時刻 = 走行.時刻() + 減速時間;
-                s 基準時刻 = 予定時刻(予定, 状態);
-                // 頻繁な力行を避けるため時刻をずらす
-                if (状態.前回力行ノッチ() > 0) {
-                    基準時刻 -= バッファ;
-                }
-                else {
-                    基準時刻 += バッファ;
-                }
-                return 到達時刻 >= 基準時刻;
+        s 現在 = 状態.現在時刻();
+        if (現在 <= _削除期限 && _削除期限算出時刻 <= 現在 &&
+            (_削除期限算出時刻 < 正午) == (現在 < 正午))
+        {
+            return;
+        }
+
+        auto 古い予定 = std::remove_if(_予定表.begin(), _予定表.end(),
+            [&](const 予定 &予定) {
+                return 予定時刻(予定.通過, 現在) + バッファ < 現在;
             });
+        if (古い予定 != _予定表.end()) {
+            _予定表.erase(古い予定, _予定表.end());
+            _基準時刻有効 = false;
+        }
+
+        _削除期限 = s::無限大();
+        for (const 予定 &予定 : _予定表) {
+            _削除期限 = std::min(_削除期限, 予定時刻(予定.通過, 現在) + バッファ);
+        }
+        _削除期限算出時刻 = 現在;
+    }
+
+    bool 早着防止::加速可(const 共通状態 &状態)
+    {
+        if (_予定減速度 != 状態.目安減速度()) {
+            _予定減速度 = 状態.目安減速度();
+            for (予定 &予定 : _予定表) {
+                予定.減速 = 減速パターン{
+                    予定.通過.位置(), 予定.通過.速度(), _予定減速度};
+            }
+        }
+
+        // 現在状態から一定時間加速する動きをまずシミュレートする
+        走行モデル 力行後 = 状態.現在走行状態();
+        短く力行(力行後, 状態.最大力行ノッチ(), 5.0_kmphps, 状態);
+
+        // 頻繁な力行を避けるため時刻をずらす
+        s 時刻ずれ = 状態.前回力行ノッチ() > 0 ? -バッファ : バッファ;
+        s 現在 = 状態.現在時刻();
+
+        auto 早着しない = [&](const 予定 &予定) {
+            // 減速にかかる時間を計算する
+            走行モデル 減速開始 = 予定.減速.パターン到達状態(力行後.速度());
+            s 減速時間 = -減速開始.時刻();
+
+            // 減速開始地点まで惰行する時間を計算する
+            走行モデル 走行 = 力行後;
+            走行.指定位置まで走行(減速開始.位置());
+
+            s 到達時刻 = 走行.時刻() + 減速時間;
+            return 到達時刻 >= 予定時刻(予定.通過, 現在) + 時刻ずれ;
+        };
+
+        // 早着するかどうかは一つでも早着になる予定があれば決まるので、
+        // 前回早着になった予定から調べる
+        if (_前回制約 < _予定表.size() && !早着しない(_予定表[_前回制約])) {
+            return false;
+        }
+
+        // 力行後は惰行と減速しかしないので、位置 p の予定に着くのは
+        // 力行後の時刻 + (p - 力行後の位置) / 基準速度 より後になる。
+        // ある予定以降の全ての予定がこれより前の予定時刻なら打ち切る
+        auto 段 = std::lower_bound(基準速度一覧.begin(), 基準速度一覧.end(),
+            力行後.速度());
+        bool 打切可 = 力行後.速度() > 0.0_mps && 段 != 基準速度一覧.end();
+        const s *以降最遅 = nullptr;
+        s 打切時刻 = -s::無限大();
+        if (打切可) {
+            基準時刻更新(現在);
+            auto k = static_cast<std::size_t>(段 - 基準速度一覧.begin());
+            以降最遅 = _以降最遅基準時刻.data() + k * _予定表.size();
+            打切時刻 = 力行後.時刻() - 力行後.位置() / *段 -
+                時刻ずれ - 打切余裕;
+        }
+        for (std::size_t i = 0; i < _予定表.size(); i++) {
+            if (打切可 && 力行後.位置() <= _予定表[i].通過.位置() &&
+                以降最遅[i] <= 打切時刻)
+            {
+                break;
+            }
+            if (i != _前回制約 && !早着しない(_予定表[i])) {
+                _前回制約 = i;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void 早着防止::基準時刻更新(s 現在時刻)
+    {
+        bool 午後 = 正午 <= 現在時刻; // 予定時刻 の補正が変わる
+        if (_基準時刻有効 && 午後 == _基準時刻午後) {
+            return;
+        }
+        _基準時刻有効 = true;
+        _基準時刻午後 = 午後;
+
+        std::size_t 予定数 = _予定表.size();
+        _以降最遅基準時刻.resize(基準速度段数 * 予定数);
+        for (std::size_t k = 0; k < 基準速度段数; k++) {
+            s *以降最遅 = _以降最遅基準時刻.data() + k * 予定数;
+            s 最遅 = -s::無限大();
+            for (std::size_t i = 予定数; i-- > 0;) {
+                const 予定 &予定 = _予定表[i];
+                最遅 = std::max(最遅, 予定時刻(予定.通過, 現在時刻) -
+                    予定.通過.位置() / 基準速度一覧[k]);
+                以降最遅[i] = 最遅;
+            }
+        }
+    }
+
+    void 早着防止::状態保存(状態書込 &書込) const
+    {
+        書込.値(_次の設定時刻);
+        書込.一覧(_予定表);
+        書込.値(_予定減速度);
+        書込.値(_前回制約);
+        書込.値(_削除期限);
+        書込.値(_削除期限算出時刻);
+        書込.値(_出力ノッチ);
+    }
+
+    void 早着防止::状態復元(状態読込 &読込)
+    {
+        読込.値(_次の設定時刻);
+        読込.一覧(_予定表);
+        読込.値(_予定減速度);
+        読込.値(_前回制約);
+        _基準時刻有効 = false; // 基準時刻は保存せず、次の経過で求め直す
+        読込.値(_削除期限);
+        読込.値(_削除期限算出時刻);
+        読込.値(_出力ノッチ);
     }
 
 }
@@ -18,8 +18,11 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
-#include <forward_list>
+#include <cstddef>
+#include <vector>
 #include "制御指令.h"
+#include "地上子振り分け.h"
+#include "減速パターン.h"
 #include "物理量.h"
 #include "走行モデル.h"
 
@@ -27,6 +30,8 @@ namespace autopilot
 {
 
     class 共通状態;
+    class 状態書込;
+    class 状態読込;
 
     class 早着防止
     {
@@ -34,18 +39,50 @@ namespace autopilot
         void リセット();
         void 発進(const 共通状態 &状態);
         void 地上子通過(const ATS_BEACONDATA &地上子, m 直前位置);
+        /// 地上子通過 で処理する種類の地上子を登録する
+        void 地上子処理登録(地上子振り分け &振り分け);
         void 経過(const 共通状態 &状態);
 
         自動制御指令 出力ノッチ() const { return _出力ノッチ; }
 
+        void 状態保存(状態書込 &書込) const;
+        void 状態復元(状態読込 &読込);
+
     private:
+        struct 予定
+        {
+            走行モデル 通過; // 通過する位置・速度と予定時刻
+            // 通過位置・速度まで目安減速度で減速する
+            減速パターン 減速 = {m::無限大(), {}, {}};
+        };
+
         s _次の設定時刻 = {};
-        std::forward_list<走行モデル> _予定表;
+        // 位置の昇順に並べた予定。確保したメモリは使い回す
+        std::vector<予定> _予定表;
+        // _予定表 の各 減速 の減速度。目安減速度が変わったら作り直す
+        mps2 _予定減速度 = {};
+        // 前回の経過で加速すると早着になった予定の添字。
+        // 次も同じ予定で早着になることが多いので最初に調べる
+        std::size_t _前回制約 = 0;
+        // 基準速度 k 段目の添字 i の値 ([k * 予定数 + i]) は、i 以降の
+        // 予定の (予定時刻 - 位置 / 基準速度) の最大値。基準速度以下の
+        // 速度で走れば位置 p の予定には (p - 現在位置) / 基準速度 より
+        // 早くは着かないので、これを使うと残りの予定で早着しないことを
+        // 個々に模擬せずに確かめられる。
+        // 速度が変わっても求め直さずに済むよう段ごとに持っておき、
+        // 予定表が変わったら (_基準時刻有効 が偽なら) 求め直す
+        std::vector<s> _以降最遅基準時刻;
+        bool _基準時刻有効 = false, _基準時刻午後 = false;
+        // これより後になるまで古くなる予定はない。
+        // _削除期限算出時刻 から時刻が戻ったら求め直す
+        s _削除期限 = -s::無限大(), _削除期限算出時刻 = {};
         自動制御指令 _出力ノッチ;
 
         void 通過時刻設定(const ATS_BEACONDATA &地上子);
         void 通過位置設定(const ATS_BEACONDATA &地上子, m 地上子位置);
-        bool 加速可(const 共通状態 &状態) const;
+        void 古い予定を削除(const 共通状態 &状態);
+        bool 加速可(const 共通状態 &状態);
+        void 基準時刻更新(s 現在時刻);
     };
 
 }
@@ -26,6 +26,12 @@
 #include "共通状態.h"
 #include "走行モデル.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUTOPILOT_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace autopilot
 {
 
@@ -45,8 +51,7 @@ namespace autopilot
         走行モデル 走行(目標位置, 目標速度);
 
         if (初期減速度 > 最終減速度) {
-            走行.等加加速度で指定加速度まで走行(
-                -最終減速度, -初期減速度, 終盤加加速度);
+            走行 = 終盤開始状態();
 
             if (走行.位置() <= 現在位置) {
                 // 行き過ぎたので計算し直す
@@ -62,7 +67,97 @@ namespace autopilot
         return { 走行.速度(), 初期減速度 };
     }
 
-    mps2 減速パターン::出力減速度(m 現在位置, mps 現在速度) const
+    void 減速パターン::期待速度と期待減速度一括計算(
+        std::size_t 個数, const m 目標位置[], const mps 目標速度[],
+        const mps2 初期減速度[], const mps2 最終減速度[],
+        m 現在位置, mps 期待速度[], mps2 期待減速度[])
+    {
+        auto 一つずつ計算 = [&](std::size_t i) {
+            減速パターン パターン{目標位置[i], 目標速度[i],
+                初期減速度[i], 最終減速度[i]};
+            std::tie(期待速度[i], 期待減速度[i]) =
+                パターン.期待速度と期待減速度(現在位置);
+        };
+        std::size_t i = 0;
+
+#ifdef AUTOPILOT_SSE2
+        // 初期減速度で減速する部分にある場合だけを二つずつ計算する。
+        // 演算の順序は 走行モデル と同じにして結果を一致させる。
+        static_assert(sizeof(m) == sizeof(double) &&
+            sizeof(mps) == sizeof(double) && sizeof(mps2) == sizeof(double),
+            "物理量 must be laid out as a plain double");
+        const double *位置列 = reinterpret_cast<const double *>(目標位置);
+        const double *速度列 = reinterpret_cast<const double *>(目標速度);
+        const double *初期列 = reinterpret_cast<const double *>(初期減速度);
+        const double *最終列 = reinterpret_cast<const double *>(最終減速度);
+        double *期待速度列 = reinterpret_cast<double *>(期待速度);
+        double *期待減速度列 = reinterpret_cast<double *>(期待減速度);
+
+        const __m128d 符号 = _mm_set1_pd(-0.0);
+        const __m128d ゼロ = _mm_setzero_pd();
+        const __m128d 二 = _mm_set1_pd(2.0);
+        const __m128d 三 = _mm_set1_pd(3.0);
+        const __m128d 加加速度 = _mm_set1_pd(終盤加加速度.value);
+        const __m128d 現在 = _mm_set1_pd(現在位置.value);
+
+        for (; i + 2 <= 個数; i += 2) {
+            __m128d 位置 = _mm_loadu_pd(位置列 + i);
+            __m128d 速度 = _mm_loadu_pd(速度列 + i);
+            __m128d 初期 = _mm_loadu_pd(初期列 + i);
+            __m128d 最終 = _mm_loadu_pd(最終列 + i);
+
+            // 等加加速度で指定加速度まで走行 と同じ計算
+            __m128d 初加速度 = _mm_xor_pd(最終, 符号);
+            __m128d 終加速度 = _mm_xor_pd(初期, 符号);
+            __m128d 時間 = _mm_div_pd(
+                _mm_sub_pd(終加速度, 初加速度), 加加速度);
+            __m128d 位置増分 = _mm_mul_pd(時間, _mm_add_pd(速度, _mm_div_pd(
+                _mm_mul_pd(時間, _mm_add_pd(初加速度, _mm_div_pd(
+                    _mm_mul_pd(時間, 加加速度), 三))), 二)));
+            __m128d 速度増分 = _mm_mul_pd(時間, _mm_add_pd(初加速度,
+                _mm_div_pd(_mm_mul_pd(時間, 加加速度), 二)));
+
+            __m128d 終盤あり = _mm_cmpgt_pd(初期, 最終);
+            __m128d 開始位置 = _mm_or_pd(
+                _mm_and_pd(終盤あり, _mm_add_pd(位置, 位置増分)),
+                _mm_andnot_pd(終盤あり, 位置));
+            __m128d 開始速度 = _mm_or_pd(
+                _mm_and_pd(終盤あり, _mm_add_pd(速度, 速度増分)),
+                _mm_andnot_pd(終盤あり, 速度));
+
+            // 目標位置を過ぎている時や終盤にある時は一つずつ計算する
+            __m128d 対象 = _mm_and_pd(
+                _mm_cmplt_pd(現在, 位置), _mm_cmplt_pd(現在, 開始位置));
+            if (_mm_movemask_pd(対象) != 0x3) {
+                一つずつ計算(i);
+                一つずつ計算(i + 1);
+                continue;
+            }
+
+            // 指定距離走行 と同じ計算
+            __m128d 距離 = _mm_sub_pd(現在, 開始位置);
+            __m128d 加速度 = 終加速度;
+            __m128d 新速度 = _mm_sqrt_pd(_mm_add_pd(
+                _mm_mul_pd(開始速度, 開始速度),
+                _mm_mul_pd(_mm_mul_pd(二, 距離), 加速度)));
+            新速度 = _mm_and_pd(新速度, _mm_cmpge_pd(新速度, ゼロ));
+            __m128d 加速なし = _mm_cmpeq_pd(加速度, ゼロ);
+            新速度 = _mm_or_pd(
+                _mm_and_pd(加速なし, 開始速度),
+                _mm_andnot_pd(加速なし, 新速度));
+
+            _mm_storeu_pd(期待速度列 + i, 新速度);
+            _mm_storeu_pd(期待減速度列 + i, 初期);
+        }
+#endif
+
+        for (; i < 個数; i++) {
+            一つずつ計算(i);
+        }
+    }
+
+    mps2 減速パターン::出力減速度(
+        m 現在位置, mps 現在速度, std::pair<mps, mps2> 期待) const
     {
         if (現在位置 >= 目標位置) {
             if (目標速度 > 0.0_mps) {
@@ -75,7 +170,7 @@ namespace autopilot
 
         mps 期待速度;
         mps2 期待減速度;
-        std::tie(期待速度, 期待減速度) = 期待速度と期待減速度(現在位置);
+        std::tie(期待速度, 期待減速度) = 期待;
 
         // 期待(減)速度に漸次的に近付けるように減速度を調整する。
         // 基本的には 2 秒後に期待速度に到達するような減速度を出力する。
@@ -120,9 +215,18 @@ namespace autopilot
     自動制動自然数ノッチ 減速パターン::出力制動ノッチ(
         m 現在位置, mps 現在速度, 自動制動自然数ノッチ 現在制動ノッチ,
         mps2 勾配影響, const 共通状態 &状態) const
+    {
+        return 出力制動ノッチ(
+            出力減速度(現在位置, 現在速度), 現在位置, 現在速度,
+            現在制動ノッチ, 勾配影響, 状態);
+    }
+
+    自動制動自然数ノッチ 減速パターン::出力制動ノッチ(
+        mps2 出力減速度, m 現在位置, mps 現在速度,
+        自動制動自然数ノッチ 現在制動ノッチ,
+        mps2 勾配影響, const 共通状態 &状態) const
     {
         const 制動特性 &制動 = 状態.制動();
-        mps2 出力減速度 = this->出力減速度(現在位置, 現在速度);
         自動制動実数ノッチ 出力実数 = 制動.自動ノッチ(出力減速度 + 勾配影響);
 
         if (目標位置 >= 現在位置) {
@@ -152,32 +256,26 @@ namespace autopilot
     }
 
     bool 減速パターン::力行する余裕あり(
-        力行ノッチ 力行ノッチ, mps2 想定加速度, s 想定惰行時間,
-        mps2 勾配影響, const 共通状態 &状態) const
+        const 走行モデル &力行後状態, mps2 勾配影響,
+        const 共通状態 &状態) const
     {
-        走行モデル モデル = 状態.現在走行状態();
-
-        // 現在状態から一定時間加速する動きをまずシミュレートする
-        短く力行(モデル, 力行ノッチ, 想定加速度, 状態);
-
-        // その後、惰行して……
-        モデル.指定時間走行(想定惰行時間, 勾配影響);
-
         // ブレーキをかける必要があるなら力行しない
         auto 制動ノッチ = 出力制動ノッチ(
-            モデル.位置(), モデル.速度(),
+            力行後状態.位置(), 力行後状態.速度(),
             自動制動自然数ノッチ{0}, 勾配影響, 状態);
         return 制動ノッチ == 自動制動自然数ノッチ{0};
     }
 
-    自動制御指令 減速パターン::出力ノッチ(const 共通状態 &状態) const
+    自動制御指令 減速パターン::出力ノッチ(
+        const 共通入力 &入力, std::pair<mps, mps2> 期待) const
     {
-        mps 現在速度 = 状態.現在速度();
-        自動制動自然数ノッチ 現在制動ノッチ =
-            状態.制動().自動ノッチ(状態.前回制動指令());
-        mps2 勾配影響 = 状態.車両勾配加速度();
+        const 共通状態 &状態 = 入力.状態;
+        mps 現在速度 = 入力.現在速度;
+        自動制動自然数ノッチ 現在制動ノッチ = 入力.現在制動ノッチ;
+        mps2 勾配影響 = 入力.勾配影響;
         自動制動自然数ノッチ 出力制動ノッチ = this->出力制動ノッチ(
-            状態.現在位置(), 現在速度, 現在制動ノッチ, 勾配影響, 状態);
+            出力減速度(入力.現在位置, 現在速度, 期待),
+            入力.現在位置, 現在速度, 現在制動ノッチ, 勾配影響, 状態);
 
         // 制動を弱めてもまたすぐ強くすることになるなら弱めない
         if (現在速度 >= static_cast<mps>(10.0_kmph) &&
@@ -187,7 +285,7 @@ namespace autopilot
             s 猶予 = 出力減速度 > 0.0_mps2 ?
                 std::clamp(
                     (現在速度 - 目標速度) / 4.0 / 出力減速度, 1.0_s, 3.0_s) :
-                状態.現在位置() < 目標位置 ? 1.0_s : 3.0_s;
+                入力.現在位置 < 目標位置 ? 1.0_s : 3.0_s;
             走行モデル モデル = 状態.現在走行状態();
             モデル.指定時間走行(猶予, -出力減速度);
             自動制動自然数ノッチ 猶予後出力制動ノッチ = this->出力制動ノッチ(
@@ -203,12 +301,10 @@ namespace autopilot
 
         // 停止直前はノッチを緩めて衝撃を抑える
         if (目標速度 == 0.0_mps) {
-            走行モデル 空走 = 状態.現在走行状態();
-            空走.指定時間走行(状態.制動().反応時間(), 状態.加速度());
             走行モデル 緩め走行{目標位置};
             mps2 緩め減速度 = std::max(
                 -緩め走行.指定速度まで走行(
-                    空走.速度(), 0.0_mps2, 2.0_kmphps2, true),
+                    入力.空走後速度, 0.0_mps2, 2.0_kmphps2, true),
                 static_cast<mps2>(0.3_kmphps));
             自動制動実数ノッチ 緩め制動ノッチ実数 =
                 状態.制動().自動ノッチ(緩め減速度 + 勾配影響);
@@ -222,12 +318,10 @@ namespace autopilot
         }
 
         // 制限速度まで余裕があるなら全力で力行する
-        力行ノッチ 最大力行ノッチ = 状態.最大力行ノッチ();
-        mps2 想定勾配影響 = std::max(勾配影響, 0.0_mps2);
         if (力行する余裕あり(
-            最大力行ノッチ, 5.0_kmphps, 5.0_s, 想定勾配影響, 状態))
+            入力.最大力行後状態(), 入力.想定勾配影響, 状態))
         {
-            return 最大力行ノッチ;
+            return 入力.最大力行ノッチ;
         }
 
         // ある程度速度が出ているなら弱い力行ノッチは無意味なので
@@ -243,13 +337,50 @@ namespace autopilot
         }
 
         if (力行する余裕あり(
-            最弱力行ノッチ, 2.5_kmphps, 1.0_s, 想定勾配影響, 状態))
+            入力.最弱力行後状態(), 入力.想定勾配影響, 状態))
         {
             return 最弱力行ノッチ;
         }
         return 惰行;
     }
 
+    減速パターン::共通入力::共通入力(const 共通状態 &状態) :
+        状態{状態},
+        現在位置{状態.現在位置()},
+        現在速度{状態.現在速度()},
+        現在制動ノッチ{状態.前回自動制動ノッチ()},
+        勾配影響{状態.車両勾配加速度()},
+        想定勾配影響{std::max(勾配影響, 0.0_mps2)},
+        最大力行ノッチ{状態.最大力行ノッチ()}
+    {
+        走行モデル 空走 = 状態.現在走行状態();
+        空走.指定時間走行(状態.制動().反応時間(), 状態.加速度());
+        空走後速度 = 空走.速度();
+    }
+
+    const 走行モデル &減速パターン::共通入力::最大力行後状態() const
+    {
+        if (!_最大力行後状態計算済) {
+            // 現在状態から一定時間加速してから惰行する動き
+            _最大力行後状態 = 状態.現在走行状態();
+            短く力行(_最大力行後状態, 最大力行ノッチ, 5.0_kmphps, 状態);
+            _最大力行後状態.指定時間走行(5.0_s, 想定勾配影響);
+            _最大力行後状態計算済 = true;
+        }
+        return _最大力行後状態;
+    }
+
+    const 走行モデル &減速パターン::共通入力::最弱力行後状態() const
+    {
+        if (!_最弱力行後状態計算済) {
+            _最弱力行後状態 = 状態.現在走行状態();
+            短く力行(_最弱力行後状態, 力行ノッチ{1}, 2.5_kmphps, 状態);
+            _最弱力行後状態.指定時間走行(1.0_s, 想定勾配影響);
+            _最弱力行後状態計算済 = true;
+        }
+        return _最弱力行後状態;
+    }
+
     走行モデル 減速パターン::パターン到達状態(mps 速度) const
     {
         走行モデル 走行{目標位置, 目標速度};
@@ -258,8 +389,7 @@ namespace autopilot
         }
 
         if (初期減速度 > 最終減速度) {
-            走行.等加加速度で指定加速度まで走行(
-                -最終減速度, -初期減速度, 終盤加加速度);
+            走行 = 終盤開始状態();
 
             if (走行.速度() > 速度) {
                 // 行き過ぎたので計算し直す
@@ -274,4 +404,22 @@ namespace autopilot
         return 走行;
     }
 
+    const 走行モデル &減速パターン::終盤開始状態() const
+    {
+        // 毎フレーム同じパターンを評価することが多いので
+        // 終盤の計算結果を使い回す
+        if (!(_終盤開始.目標位置 == 目標位置 &&
+            _終盤開始.目標速度 == 目標速度 &&
+            _終盤開始.初期減速度 == 初期減速度 &&
+            _終盤開始.最終減速度 == 最終減速度))
+        {
+            走行モデル 走行{目標位置, 目標速度};
+            走行.等加加速度で指定加速度まで走行(
+                -最終減速度, -初期減速度, 終盤加加速度);
+            _終盤開始 = 終盤開始キャッシュ{
+                目標位置, 目標速度, 初期減速度, 最終減速度, 走行};
+        }
+        return _終盤開始.状態;
+    }
+
 }
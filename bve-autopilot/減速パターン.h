@@ -18,6 +18,7 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
+#include <cstddef>
 #include <utility>
 #include "制動特性.h"
 #include "制御指令.h"
@@ -59,14 +60,62 @@ namespace autopilot
             return 期待速度と期待減速度(現在位置).first;
         }
 
-        mps2 出力減速度(m 現在位置, mps 現在速度) const;
+        /// 同じ現在位置について多くのパターンの期待速度と期待減速度を
+        /// まとめて求めます。結果はパターンごとに 期待速度と期待減速度 を
+        /// 呼んだ時と完全に一致します。
+        static void 期待速度と期待減速度一括計算(
+            std::size_t 個数, const m 目標位置[], const mps 目標速度[],
+            const mps2 初期減速度[], const mps2 最終減速度[],
+            m 現在位置, mps 期待速度[], mps2 期待減速度[]);
+
+        mps2 出力減速度(m 現在位置, mps 現在速度) const {
+            return 出力減速度(
+                現在位置, 現在速度, 期待速度と期待減速度(現在位置));
+        }
+        /// 期待 は現在位置での 期待速度と期待減速度 の結果
+        mps2 出力減速度(
+            m 現在位置, mps 現在速度, std::pair<mps, mps2> 期待) const;
         自動制動自然数ノッチ 出力制動ノッチ(
             m 現在位置, mps 現在速度, 自動制動自然数ノッチ 現在制動ノッチ,
             mps2 勾配影響, const 共通状態 &状態) const;
         bool 力行する余裕あり(
-            力行ノッチ 力行ノッチ, mps2 想定加速度, s 想定惰行時間,
-            mps2 勾配影響, const 共通状態 &状態) const;
-        自動制御指令 出力ノッチ(const 共通状態 &状態) const;
+            const 走行モデル &力行後状態, mps2 勾配影響,
+            const 共通状態 &状態) const;
+
+        /// 出力ノッチ の計算のうちパターンによらない部分。
+        /// 一フレームに多くのパターンを評価する時は一度だけ作って使い回す。
+        struct 共通入力
+        {
+            explicit 共通入力(const 共通状態 &状態);
+
+            const 共通状態 &状態;
+            m 現在位置;
+            mps 現在速度;
+            自動制動自然数ノッチ 現在制動ノッチ;
+            mps2 勾配影響, 想定勾配影響;
+            mps 空走後速度; // 制動の反応時間だけ進んだ後の速度
+            力行ノッチ 最大力行ノッチ;
+
+            // 短く力行してから惰行した後の状態。
+            // 制動するパターンでは使わないので初めて使う時に計算する
+            const 走行モデル &最大力行後状態() const;
+            const 走行モデル &最弱力行後状態() const;
+
+        private:
+            mutable 走行モデル _最大力行後状態, _最弱力行後状態;
+            mutable bool _最大力行後状態計算済 = false;
+            mutable bool _最弱力行後状態計算済 = false;
+        };
+
+        自動制御指令 出力ノッチ(const 共通状態 &状態) const {
+            return 出力ノッチ(共通入力{状態});
+        }
+        自動制御指令 出力ノッチ(const 共通入力 &入力) const {
+            return 出力ノッチ(入力, 期待速度と期待減速度(入力.現在位置));
+        }
+        /// 期待 は現在位置での 期待速度と期待減速度 の結果
+        自動制御指令 出力ノッチ(
+            const 共通入力 &入力, std::pair<mps, mps2> 期待) const;
 
         /// 指定した速度におけるパターン上の位置と時刻を返します。
         /// 時刻は、減速目標に到達する時刻を 0 とし、
@@ -74,6 +123,23 @@ namespace autopilot
         /// 指定した速度が目標速度以下ならパターン終了時の状態を返します。
         走行モデル パターン到達状態(mps 速度) const;
 
+    private:
+        // 終盤 (最終減速度から初期減速度へ一定の加加速度で変わる部分) の
+        // 開始状態。パターンの値が変わったら計算し直す。
+        struct 終盤開始キャッシュ
+        {
+            m 目標位置 = m::無限大();
+            mps 目標速度 = {};
+            mps2 初期減速度 = {}, 最終減速度 = {};
+            走行モデル 状態 = 走行モデル{};
+        };
+        mutable 終盤開始キャッシュ _終盤開始;
+
+        const 走行モデル &終盤開始状態() const;
+        自動制動自然数ノッチ 出力制動ノッチ(
+            mps2 出力減速度, m 現在位置, mps 現在速度,
+            自動制動自然数ノッチ 現在制動ノッチ,
+            mps2 勾配影響, const 共通状態 &状態) const;
     };
 
 }
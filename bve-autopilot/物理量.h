@@ -420,6 +420,9 @@ namespace autopilot
     constexpr mps2 operator/(const m2ps2 &a, const m &b) {
         return static_cast<mps2>(a.value / b.value);
     }
+    constexpr m operator/(const m2ps2 &a, const mps2 &b) {
+        return static_cast<m>(a.value / b.value);
+    }
 
     inline mps sqrt(const m2ps2 &v) {
         return static_cast<mps>(std::sqrt(v.value));
@@ -0,0 +1,123 @@
+// 状態保存.h : 自動運転の状態を二進形式で保存・復元します
+//
+// Copyright © 2019 Watanabe, Yuki
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#pragma warning(push)
+#pragma warning(disable:4819)
+
+namespace autopilot
+{
+
+    /// 各部品の状態を一つのバイト列に書き足していきます。
+    /// 値はメモリ上の表現をそのまま書くので、書き出したものは同じビルドの
+    /// プログラムでしか読めません (再生中に巻き戻すためのものです)。
+    class 状態書込
+    {
+    public:
+        explicit 状態書込(std::vector<unsigned char> &出力先) :
+            _出力先{出力先} {}
+
+        template<typename T>
+        void 値(const T &値) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const auto *p = reinterpret_cast<const unsigned char *>(&値);
+            _出力先.insert(_出力先.end(), p, p + sizeof(T));
+        }
+
+        void 個数(std::size_t 個数) {
+            値(static_cast<std::uint64_t>(個数));
+        }
+
+        /// 個数と全要素をまとめて書く
+        template<typename T, typename A>
+        void 一覧(const std::vector<T, A> &一覧) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            個数(一覧.size());
+            const auto *p = reinterpret_cast<const unsigned char *>(一覧.data());
+            _出力先.insert(_出力先.end(), p, p + sizeof(T) * 一覧.size());
+        }
+
+    private:
+        std::vector<unsigned char> &_出力先;
+    };
+
+    /// 状態書込 で書いたものを同じ順に読み出します。
+    /// 途中で終わっていれば std::runtime_error を投げます。
+    class 状態読込
+    {
+    public:
+        状態読込(const unsigned char *先頭, std::size_t 大きさ) :
+            _位置{先頭}, _残り{大きさ} {}
+
+        std::size_t 残り() const { return _残り; }
+
+        template<typename T>
+        void 値(T &値) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::memcpy(&値, 取り出す(sizeof(T)), sizeof(T));
+        }
+
+        /// 一つ以上の大きさを持つ要素の個数を読む。
+        /// 残りに収まらない個数なら途中で終わっているとみなす
+        std::size_t 個数(std::size_t 要素の大きさ = 1) {
+            std::uint64_t 個数;
+            値(個数);
+            if (個数 > _残り / 要素の大きさ) {
+                途切れた();
+            }
+            return static_cast<std::size_t>(個数);
+        }
+
+        template<typename T, typename A>
+        void 一覧(std::vector<T, A> &一覧) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::size_t n = 個数(sizeof(T));
+            一覧.resize(n);
+            std::memcpy(一覧.data(), 取り出す(sizeof(T) * n), sizeof(T) * n);
+        }
+
+    private:
+        const unsigned char *_位置;
+        std::size_t _残り;
+
+        const unsigned char *取り出す(std::size_t 大きさ) {
+            if (大きさ > _残り) {
+                途切れた();
+            }
+            const unsigned char *p = _位置;
+            _位置 += 大きさ;
+            _残り -= 大きさ;
+            return p;
+        }
+
+        [[noreturn]] static void 途切れた() {
+            throw std::runtime_error("truncated autopilot snapshot");
+        }
+    };
+
+}
+
+#pragma warning(pop)
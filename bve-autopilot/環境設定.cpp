@@ -19,6 +19,7 @@
 
 #include "stdafx.h"
 #include "環境設定.h"
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cwchar>
@@ -129,6 +130,8 @@ namespace autopilot
         _tasc初期起動(true),
         _ato初期起動(true),
         _車両長(20),
+        _加速度推定方式(加速度計::推定方式::差分平均),
+        _加速度推定窓長(加速度計::既定窓長),
         _加速終了遅延(2.0_s),
         _常用最大減速度(3.0_kmphps),
         _制動反応時間(0.2_s),
@@ -138,7 +141,7 @@ namespace autopilot
         _キー割り当て{
             {キー操作::モード切替, デフォルトキー組合せ()},
             {キー操作::ato発進, デフォルトキー組合せ()}, },
-        _パネル出力対象登録簿(),
+        _パネル出力割当(),
         _音声割り当て{}
     {
     }
@@ -188,6 +191,34 @@ namespace autopilot
             }
         }
 
+        // 加速度の推定方式
+        size = GetPrivateProfileStringW(
+            L"dynamics", L"accelerationmethod", L"", buffer, buffer_size,
+            設定ファイル名);
+        if (0 < size && size < buffer_size - 1) {
+            if (buffer == L"difference"sv) {
+                _加速度推定方式 = 加速度計::推定方式::差分平均;
+            }
+            else if (buffer == L"leastsquares"sv) {
+                _加速度推定方式 = 加速度計::推定方式::最小二乗;
+            }
+        }
+
+        // 加速度を推定するのに使うフレーム数
+        size = GetPrivateProfileStringW(
+            L"dynamics", L"accelerationwindow", L"", buffer, buffer_size,
+            設定ファイル名);
+        if (0 < size && size < buffer_size - 1) {
+            int 窓長 = std::wcstol(buffer, nullptr, 10);
+            if (1 <= 窓長) {
+                _加速度推定窓長 = static_cast<std::size_t>(窓長);
+            }
+        }
+        if (_加速度推定方式 == 加速度計::推定方式::最小二乗) {
+            // 直線を当てはめるには記録が二つ以上要る
+            _加速度推定窓長 = std::max<std::size_t>(_加速度推定窓長, 2);
+        }
+
         // 加速終了遅延
         size = GetPrivateProfileStringW(
             L"power", L"offdelay", L"", buffer, buffer_size,
@@ -283,7 +314,7 @@ namespace autopilot
                 if (index < 0 || 256 <= index) {
                     continue;
                 }
-                _パネル出力対象登録簿.insert_or_assign(
+                _パネル出力割当.割当(
                     index, パネル出力対象::対象(設定.second));
             }
             catch (const std::invalid_argument &) {
@@ -23,6 +23,7 @@
 #include <unordered_map>
 #include <vector>
 #include "制御指令.h"
+#include "加速度計.h"
 #include "パネル出力.h"
 #include "物理量.h"
 
@@ -62,6 +63,8 @@ namespace autopilot
         bool tasc初期起動() const { return _tasc初期起動; }
         bool ato初期起動() const { return _ato初期起動; }
         m 車両長() const { return _車両長; }
+        加速度計::推定方式 加速度推定方式() const { return _加速度推定方式; }
+        std::size_t 加速度推定窓長() const { return _加速度推定窓長; }
         s 加速終了遅延() const { return _加速終了遅延; }
         mps2 常用最大減速度() const { return _常用最大減速度; }
         s 制動反応時間() const { return _制動反応時間; }
@@ -77,9 +80,8 @@ namespace autopilot
             return _キー割り当て;
         }
 
-        const std::unordered_map<int, パネル出力対象> & パネル出力対象登録簿()
-            const {
-            return _パネル出力対象登録簿;
+        const パネル出力表 &パネル出力割当() const {
+            return _パネル出力割当;
         }
 
         const std::unordered_map<音声, 音声出力先> &音声割り当て() const {
@@ -89,6 +91,8 @@ namespace autopilot
     private:
         bool _tasc初期起動, _ato初期起動;
         m _車両長;
+        加速度計::推定方式 _加速度推定方式;
+        std::size_t _加速度推定窓長;
         s _加速終了遅延;
         mps2 _常用最大減速度;
         s _制動反応時間;
@@ -97,7 +101,7 @@ namespace autopilot
         std::vector<制動力割合> _pressure_rates;
 
         std::unordered_map<キー操作, キー組合せ> _キー割り当て;
-        std::unordered_map<int, パネル出力対象> _パネル出力対象登録簿;
+        パネル出力表 _パネル出力割当;
         std::unordered_map<音声, 音声出力先> _音声割り当て;
     };
 
@@ -81,15 +81,22 @@ namespace autopilot {
 
     mps2 走行モデル::指定位置まで走行(m 位置, mps2 初加速度, mps3 加加速度)
     {
-        // 三次方程式を代数的に解くのは面倒なのでニュートン法を使う。
+        // 三次方程式を代数的に解くのは面倒なので反復法を使う。
         // 実数解が複数あるときどの解に行きつくかは分からない。
         走行モデル tmp = *this;
         mps2 加速度 = 初加速度;
-        for (size_t i = 0; i < 10; i++) {
+        s 前回時刻 = {};
+        for (std::size_t i = 0; i < 最大反復回数; i++) {
             tmp.指定位置まで走行(位置, 加速度);
             auto 時刻 = tmp.時刻();
             tmp = *this;
             加速度 = tmp.指定時刻まで走行(時刻, 初加速度, 加加速度);
+
+            // 時刻が前回と全く同じなら以降の反復でも同じ結果にしかならない
+            if (i > 0 && 時刻 == 前回時刻) {
+                break;
+            }
+            前回時刻 = 時刻;
         }
 
         *this = tmp;
@@ -18,6 +18,7 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #pragma once
+#include <cstddef>
 #include "制御指令.h"
 #include "物理量.h"
 
@@ -54,6 +55,7 @@ namespace autopilot {
         void 指定速度まで走行(mps 速度, mps2 加速度 = {});
 
         // 等加加速度運動
+        static constexpr std::size_t 最大反復回数 = 10;
         mps2 指定位置まで走行(m 位置, mps2 初加速度, mps3 加加速度);
         void 等加加速度で指定加速度まで走行(
             mps2 初加速度, mps2 終加速度, mps3 加加速度);